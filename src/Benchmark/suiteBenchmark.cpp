@@ -0,0 +1,450 @@
+/**
+ * @file suiteBenchmark.cpp
+ * @brief Benchmarks of loading, lookups, searches, queues and every routing mode, as JSON
+ *
+ * @details Usage: DA2425_PRJ1_G75_benchmarks [--data=<folder>] [--synthetic=<n>,...]
+ * [--queries=<n>] [--sources=<n>] [--repeat=<r>] [--threads=<t>,...] [--out=<file>]
+ *
+ * Benchmarks: graph loading, id and code lookups, full dijkstra searches with every
+ * queue policy (binary, 4-ary, radix and Dial heaps, whose distances must agree),
+ * operations of the priority queues, every routing mode, and the thread scaling of
+ * the driving mode.
+ *
+ * Datasets: the Porto graph of the data folder (default src/Main/CreateGraph), the small
+ * Loc1.csv/Dist1.csv graph of the same folder, and synthetic perturbed grids of the
+ * given sizes (default 10000 and 100000 vertices), written to a temporary folder by
+ * the generator of DA2425_PRJ1_G75_generate with its default options.
+ * Every benchmark runs once to warm up and then `repeat` times (default 5); the median
+ * and the fastest run are reported. Inputs are drawn from a fixed seed, so runs are
+ * repeatable, and every benchmark reports a checksum of what it computed, which must
+ * not change between releases. The modes are the ones of main.cpp, linked in with
+ * DA2425_NO_MAIN, and write into a string stream. The multi-thread runs answer the same
+ * driving queries with 1, 2, 4, ... threads (default up to hardware_concurrency).
+ *
+ * Results are written as one JSON object, to stdout unless --out is given; progress
+ * goes to stderr.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Generator/graphGenerator.h"
+#include "../Main/data_structures/createGraphs.h"
+#include "../Main/data_structures/MutablePriorityQueue.h"
+#include "../Main/data_structures/ParallelFor.h"
+#include "../Main/Modes/driving.h"
+#include "../Main/Modes/sourcetree.h"
+
+using namespace std;
+
+// Defined in main.cpp
+void ModeDriving(const CSRGraph<int> &g, int source, int destination, unsigned alternatives, std::ostream& outputFile, SourceTree<int> *tree);
+void ModeDrivingRestrictions(const CSRGraph<int> &g, const RouteOverlay &overlay, int source, int destination, std::ostream& outputFile, SourceTree<int> *tree);
+void ModeDrivingandWalking(const CSRGraph<int> &g, const RouteOverlay &overlay, int source, int destination, int maxWalkTime, std::ostream& outputFile, SourceTree<int> *tree);
+
+/**
+ * @brief Settings of a run, from the command line
+ */
+struct BenchConfig {
+    string dataFolder = "src/Main/CreateGraph";
+    vector<int> synthetic = {10000, 100000};
+    unsigned queries = 200;
+    unsigned sources = 50;
+    unsigned repeat = 5;
+    vector<unsigned> threads;
+    string out;
+    unsigned seed = 42;
+};
+
+/**
+ * @brief Measurement of one benchmark on one dataset
+ */
+struct BenchResult {
+    string name;
+    string dataset;
+    int vertices = 0;
+    int edges = 0;
+    unsigned threads = 1;
+    size_t ops = 1;            ///< operations timed in one run
+    double medianMs = 0;       ///< of one run
+    double minMs = 0;
+    long long checksum = 0;
+};
+
+/**
+ * @brief A loaded dataset
+ */
+struct Dataset {
+    string name;
+    string folder;
+    CSRGraph<int> g;
+};
+
+/**
+ * @brief Times a function: once to warm up, then `repeat` times
+ * @param fn long long(): runs the operations once, returns their checksum
+ */
+template <class F>
+BenchResult measure(const BenchConfig &config, const Dataset &data, const string &name, size_t ops, F fn,
+                    unsigned threads = 1) {
+    BenchResult result;
+    result.name = name;
+    result.dataset = data.name;
+    result.vertices = data.g.getNumVertex();
+    result.edges = data.g.getNumEdges();
+    result.threads = threads;
+    result.ops = ops;
+    result.checksum = fn();
+    vector<double> times;
+    for (unsigned r = 0; r < config.repeat; r++) {
+        auto start = chrono::steady_clock::now();
+        long long checksum = fn();
+        times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        if (checksum != result.checksum) cerr << "Error: " << name << " is not deterministic" << endl;
+    }
+    sort(times.begin(), times.end());
+    result.medianMs = times[times.size() / 2];
+    result.minMs = times[0];
+    cerr << "  " << left << setw(34) << name << right << setw(12) << fixed << setprecision(3)
+         << result.medianMs << " ms" << endl;
+    return result;
+}
+
+/**
+ * @brief Times full dijkstra searches from the first `sources` pairs with one queue policy
+ * @tparam Queue Priority queue of the search
+ * @return The measurement; its checksum, the sum of every distance found, must be the
+ * same for every queue
+ */
+template <class Queue>
+BenchResult searchQueue(const BenchConfig &config, const Dataset &data, const string &name,
+                        const vector<pair<int, int>> &pairs, bool walking) {
+    const CSRGraph<int> &g = data.g;
+    BasicSearchContext<Queue> ctx;
+    return measure(config, data, name, config.sources, [&]() {
+        long long sum = 0;
+        for (unsigned i = 0; i < config.sources; i++) {
+            dijkstra(g, pairs[i].first, walking, ctx);
+            for (int v = 0; v < g.getNumVertex(); v++) {
+                if (ctx.getDist(v) != INF_DIST) sum += ctx.getDist(v);
+            }
+        }
+        return sum;
+    });
+}
+
+/**
+ * @brief Draws distinct pairs of vertex IDs, optionally without parking
+ */
+vector<pair<int, int>> drawPairs(const CSRGraph<int> &g, unsigned count, unsigned seed, bool noParking) {
+    vector<int> ids;
+    for (int v = 0; v < g.getNumVertex(); v++) {
+        if (!noParking || !g.getParking(v)) ids.push_back(g.getInfo(v));
+    }
+    vector<pair<int, int>> pairs;
+    if (ids.size() < 2) return pairs;
+    mt19937 rng(seed);
+    uniform_int_distribution<size_t> pick(0, ids.size() - 1);
+    while (pairs.size() < count) {
+        int s = ids[pick(rng)], d = ids[pick(rng)];
+        if (s != d) pairs.push_back({s, d});
+    }
+    return pairs;
+}
+
+/**
+ * @brief Element of the MutablePriorityQueue benchmark
+ */
+struct QueueItem {
+    int key = 0;
+    unsigned queueIndex = 0;
+    bool operator<(const QueueItem &other) const { return key < other.key; }
+};
+
+/**
+ * @brief Runs every benchmark on one dataset
+ */
+void benchmarkDataset(const BenchConfig &config, Dataset &data, vector<BenchResult> &results) {
+    cerr << data.name << ": " << data.g.getNumVertex() << " vertices, " << data.g.getNumEdges() << " edges" << endl;
+    if (data.g.getNumVertex() < 2) return;
+    const CSRGraph<int> &g = data.g;
+
+    // load
+    results.push_back(measure(config, data, "load.graphFromFile", 1, [&]() {
+        return (long long) createGraphs::graphFromFile(data.folder).getNumVertex();
+    }));
+    results.push_back(measure(config, data, "load.snapshot", 1, [&]() {
+        return (long long) createGraphs::loadSnapshot(data.folder + "/graph.bin")->getNumVertex();
+    }));
+
+    // lookups on the Vertex based graph
+    Graph<int> graph = createGraphs::graphFromFile(data.folder);
+    vector<int> ids;
+    vector<string> codes;
+    mt19937 rng(config.seed);
+    for (Vertex<int> *v : graph.getVertexSet()) {
+        ids.push_back(v->getInfo());
+        codes.push_back(v->getCode());
+    }
+    const size_t lookups = 100000;
+    vector<size_t> picks(lookups);
+    for (size_t &p : picks) p = uniform_int_distribution<size_t>(0, ids.size() - 1)(rng);
+    results.push_back(measure(config, data, "lookup.findVertex", lookups, [&]() {
+        long long sum = 0;
+        for (size_t p : picks) sum += graph.findVertex(ids[p])->getInfo();
+        return sum;
+    }));
+    results.push_back(measure(config, data, "lookup.findCode", lookups, [&]() {
+        long long sum = 0;
+        for (size_t p : picks) sum += graph.findCode(codes[p])->getInfo();
+        return sum;
+    }));
+
+    // full searches, per metric and queue policy
+    vector<pair<int, int>> pairs = drawPairs(g, max(config.queries, config.sources), config.seed, false);
+    for (int walking = 0; walking < 2; walking++) {
+        string metric = walking ? "dijkstra.walking" : "dijkstra.driving";
+        size_t first = results.size();
+        results.push_back(searchQueue<MutableIndexPriorityQueue<int>>(config, data, metric + ".binary", pairs, walking));
+        results.push_back(searchQueue<DaryIndexPriorityQueue<int, 4>>(config, data, metric + ".4ary", pairs, walking));
+        results.push_back(searchQueue<RadixIndexPriorityQueue<int>>(config, data, metric + ".radix", pairs, walking));
+        results.push_back(searchQueue<BucketIndexPriorityQueue<int>>(config, data, metric + ".dial", pairs, walking));
+        for (size_t i = first + 1; i < results.size(); i++) {
+            if (results[i].checksum != results[first].checksum) {
+                cerr << "Error: " << results[i].name << " finds other distances than " << results[first].name << endl;
+            }
+        }
+    }
+
+    // queue operations: insert every element, decrease half of the keys, extract all
+    size_t n = max(g.getNumVertex(), 1000);
+    vector<int> keys(n), lower(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = uniform_int_distribution<int>(1000, 100000)(rng);
+        lower[i] = uniform_int_distribution<int>(0, keys[i])(rng);
+    }
+    size_t queueOps = n + n / 2 + n;
+    results.push_back(measure(config, data, "queue.MutablePriorityQueue", queueOps, [&]() {
+        vector<QueueItem> items(n);
+        MutablePriorityQueue<QueueItem> q;
+        for (size_t i = 0; i < n; i++) {
+            items[i].key = keys[i];
+            q.insert(&items[i]);
+        }
+        for (size_t i = 0; i < n; i += 2) {
+            items[i].key = lower[i];
+            q.decreaseKey(&items[i]);
+        }
+        long long sum = 0, order = 0;
+        while (!q.empty()) sum += q.extractMin()->key * (++order % 7);
+        return sum;
+    }));
+    results.push_back(measure(config, data, "queue.MutableIndexPriorityQueue", queueOps, [&]() {
+        vector<int> key(keys);
+        MutableIndexPriorityQueue<int> q(key);
+        q.reset(n);
+        for (size_t i = 0; i < n; i++) q.insert((int) i);
+        for (size_t i = 0; i < n; i += 2) {
+            key[i] = lower[i];
+            q.decreaseKey((int) i);
+        }
+        long long sum = 0, order = 0;
+        while (!q.empty()) sum += key[q.extractMin()] * (++order % 7);
+        return sum;
+    }));
+
+    // modes, on the same queries every run
+    pairs.resize(config.queries);
+    results.push_back(measure(config, data, "mode.driving", pairs.size(), [&]() {
+        long long bytes = 0;
+        for (auto [s, d] : pairs) {
+            ostringstream out;
+            ModeDriving(g, s, d, 0, out, nullptr);
+            bytes += out.str().size();
+        }
+        return bytes;
+    }));
+
+    vector<RouteOverlay> overlays(pairs.size());
+    uniform_int_distribution<int> anyVertex(0, g.getNumVertex() - 1);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        for (int k = 0; k < 2; k++) {
+            int v = anyVertex(rng);
+            if (g.getInfo(v) != pairs[i].first && g.getInfo(v) != pairs[i].second) overlays[i].avoidNode(v);
+        }
+        int v = anyVertex(rng);
+        if (g.outBegin(v) < g.outEnd(v)) overlays[i].avoidSegment(g, g.getInfo(v), g.getInfo(g.getDest(g.outBegin(v))));
+    }
+    results.push_back(measure(config, data, "mode.drivingRestrictions", pairs.size(), [&]() {
+        long long bytes = 0;
+        for (size_t i = 0; i < pairs.size(); i++) {
+            ostringstream out;
+            ModeDrivingRestrictions(g, overlays[i], pairs[i].first, pairs[i].second, out, nullptr);
+            bytes += out.str().size();
+        }
+        return bytes;
+    }));
+
+    vector<pair<int, int>> walkPairs = drawPairs(g, config.queries, config.seed + 1, true);
+    results.push_back(measure(config, data, "mode.drivingWalking", walkPairs.size(), [&]() {
+        long long bytes = 0;
+        for (auto [s, d] : walkPairs) {
+            ostringstream out;
+            ModeDrivingandWalking(g, RouteOverlay(), s, d, 20, out, nullptr);
+            bytes += out.str().size();
+        }
+        return bytes;
+    }));
+
+    // thread scaling of the driving mode
+    for (unsigned threads : config.threads) {
+        results.push_back(measure(config, data, "scaling.driving", pairs.size(), [&]() {
+            vector<long long> bytes(pairs.size());
+            parallelFor(pairs.size(), threads, [&](size_t i) {
+                ostringstream out;
+                ModeDriving(g, pairs[i].first, pairs[i].second, 0, out, nullptr);
+                bytes[i] = out.str().size();
+            });
+            long long sum = 0;
+            for (long long b : bytes) sum += b;
+            return sum;
+        }, threads));
+    }
+}
+
+/**
+ * @brief Escapes a string for JSON
+ */
+string jsonString(const string &s) {
+    string res = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') res += '\\';
+        if ((unsigned char) c < 0x20) {
+            res += ' ';
+            continue;
+        }
+        res += c;
+    }
+    return res + "\"";
+}
+
+/**
+ * @brief Writes the results as JSON
+ */
+void writeJson(const BenchConfig &config, const vector<BenchResult> &results, ostream &out) {
+    out << "{\n  \"config\": {\"repeat\": " << config.repeat << ", \"queries\": " << config.queries
+        << ", \"sources\": " << config.sources << ", \"seed\": " << config.seed
+        << ", \"hardware_threads\": " << thread::hardware_concurrency() << "},\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        double single = r.medianMs;
+        for (const BenchResult &other : results) {
+            if (other.name == r.name && other.dataset == r.dataset && other.threads == 1) single = other.medianMs;
+        }
+        out << (i ? "," : "") << "\n    {\"name\": " << jsonString(r.name) << ", \"dataset\": " << jsonString(r.dataset)
+            << ", \"vertices\": " << r.vertices << ", \"edges\": " << r.edges << ", \"threads\": " << r.threads
+            << ", \"ops\": " << r.ops << setprecision(6) << defaultfloat
+            << ", \"median_ms\": " << r.medianMs << ", \"min_ms\": " << r.minMs
+            << ", \"ns_per_op\": " << r.medianMs * 1e6 / r.ops
+            << ", \"ops_per_s\": " << (r.medianMs > 0 ? r.ops * 1000.0 / r.medianMs : 0)
+            << ", \"speedup\": " << (r.medianMs > 0 ? single / r.medianMs : 0)
+            << ", \"checksum\": " << r.checksum << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/**
+ * @brief Reads a comma separated list of numbers
+ */
+template <class N>
+vector<N> parseList(const string &text) {
+    vector<N> res;
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) res.push_back((N) stoll(item));
+    }
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--data=", 0) == 0) {
+            config.dataFolder = arg.substr(7);
+        } else if (arg.rfind("--synthetic=", 0) == 0) {
+            config.synthetic = parseList<int>(arg.substr(12));
+        } else if (arg.rfind("--queries=", 0) == 0) {
+            config.queries = stoi(arg.substr(10));
+        } else if (arg.rfind("--sources=", 0) == 0) {
+            config.sources = stoi(arg.substr(10));
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            config.repeat = stoi(arg.substr(9));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            config.threads = parseList<unsigned>(arg.substr(10));
+        } else if (arg.rfind("--out=", 0) == 0) {
+            config.out = arg.substr(6);
+        } else {
+            cerr << "Error: Unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (config.queries == 0 || config.sources == 0 || config.repeat == 0) {
+        cerr << "Error: --queries, --sources and --repeat must be positive" << endl;
+        return 1;
+    }
+    if (config.threads.empty()) {
+        for (unsigned t = 1; t < max(1u, thread::hardware_concurrency()); t *= 2) config.threads.push_back(t);
+        config.threads.push_back(max(1u, thread::hardware_concurrency()));
+    }
+
+    // Loc1.csv/Dist1.csv and the synthetic graphs are loaded from a temporary folder
+    error_code ec;
+    string scratch = (filesystem::temp_directory_path(ec) / ("da_bench_" + to_string(random_device()()))).string();
+    vector<pair<string, string>> folders = {{"porto", config.dataFolder}};
+    if (filesystem::exists(config.dataFolder + "/Loc1.csv") && filesystem::exists(config.dataFolder + "/Dist1.csv")) {
+        filesystem::create_directories(scratch + "/small");
+        filesystem::copy_file(config.dataFolder + "/Loc1.csv", scratch + "/small/Locations.csv");
+        filesystem::copy_file(config.dataFolder + "/Dist1.csv", scratch + "/small/Distances.csv");
+        folders.push_back({"small", scratch + "/small"});
+    }
+    for (int n : config.synthetic) {
+        string folder = scratch + "/grid" + to_string(n);
+        filesystem::create_directories(folder);
+        GeneratorOptions options;
+        options.nodes = n;
+        options.seed = config.seed;
+        GeneratorStats stats;
+        if (!generateGraph(folder, options, stats)) return 1;
+        folders.push_back({"grid-" + to_string(n), folder});
+    }
+
+    vector<BenchResult> results;
+    for (const auto &[name, folder] : folders) {
+        Dataset data{name, folder, createGraphs::snapshotFromFolder(folder)};
+        benchmarkDataset(config, data, results);
+    }
+    filesystem::remove_all(scratch, ec);
+
+    if (config.out.empty()) {
+        writeJson(config, results, cout);
+    } else {
+        ofstream out(config.out);
+        if (!out) {
+            cerr << "Error: Could not open file " << config.out << endl;
+            return 1;
+        }
+        writeJson(config, results, out);
+    }
+    return 0;
+}
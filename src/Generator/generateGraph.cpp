@@ -0,0 +1,79 @@
+/**
+ * @file generateGraph.cpp
+ * @brief Writes a synthetic Locations.csv/Distances.csv graph
+ *
+ * @details Usage: DA2425_PRJ1_G75_generate [--out=<folder>] [--nodes=<n>]
+ * [--topology=grid|geometric] [--degree=<mean roads per location>]
+ * [--degree-dist=fixed|poisson] [--parking=<share>] [--driving-only=<share>]
+ * [--walking-only=<share>] [--seed=<s>]
+ *
+ * The defaults follow the Porto graph (see GeneratorOptions). The same options always
+ * write the same files. The folder, "synthetic" by default, is created if needed and
+ * can be given to DA2425_PRJ1_G75 with --graph=<folder>. What was written is printed
+ * to stderr.
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "graphGenerator.h"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    GeneratorOptions options;
+    string folder = "synthetic";
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg.rfind("--out=", 0) == 0) {
+                folder = arg.substr(6);
+            } else if (arg.rfind("--nodes=", 0) == 0) {
+                options.nodes = stoll(arg.substr(8));
+            } else if (arg.rfind("--topology=", 0) == 0) {
+                if (!parseTopology(arg.substr(11), options.topology)) {
+                    cerr << "Error: Unknown topology " << arg.substr(11) << endl;
+                    return 1;
+                }
+            } else if (arg.rfind("--degree=", 0) == 0) {
+                options.degree = stod(arg.substr(9));
+            } else if (arg.rfind("--degree-dist=", 0) == 0) {
+                if (!parseDegreeDistribution(arg.substr(14), options.degreeDistribution)) {
+                    cerr << "Error: Unknown degree distribution " << arg.substr(14) << endl;
+                    return 1;
+                }
+            } else if (arg.rfind("--parking=", 0) == 0) {
+                options.parking = stod(arg.substr(10));
+            } else if (arg.rfind("--driving-only=", 0) == 0) {
+                options.drivingOnly = stod(arg.substr(15));
+            } else if (arg.rfind("--walking-only=", 0) == 0) {
+                options.walkingOnly = stod(arg.substr(15));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                options.seed = stoull(arg.substr(7));
+            } else {
+                cerr << "Error: Unknown argument " << arg << endl;
+                return 1;
+            }
+        }
+    } catch (const exception &) {
+        cerr << "Error: Invalid number in the arguments" << endl;
+        return 1;
+    }
+
+    error_code ec;
+    filesystem::create_directories(folder, ec);
+    auto start = chrono::steady_clock::now();
+    GeneratorStats stats;
+    if (!generateGraph(folder, options, stats)) return 1;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cerr << fixed << setprecision(3)
+         << "Locations: " << stats.nodes << " (" << 100.0 * stats.parking / stats.nodes << "% with parking)\n"
+         << "Roads: " << stats.roads << " (" << 2.0 * stats.roads / stats.nodes << " per location)\n"
+         << "Driving only: " << stats.drivingOnly << ", walking only: " << stats.walkingOnly << "\n"
+         << "Written to " << folder << " in " << seconds << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,373 @@
+/**
+ * @file graphGenerator.h
+ * @brief Synthetic road graphs written as Locations.csv and Distances.csv
+ *
+ * @details Two road-like topologies are generated:
+ * - Grid: a perturbed grid, city blocks of slightly jittered corners, with some
+ *   streets missing and some diagonals added to reach the requested degree;
+ * - Geometric: a random geometric graph, locations spread uniformly over a square,
+ *   each linked to a few of its nearest neighbours.
+ * Times come from the length of the road, scaled so that an average road takes
+ * about 6 minutes to drive and 32 to walk, like the Porto graph.
+ *
+ * Every random choice is a hash of the seed and of the location or road it is
+ * about, so the output only depends on the options, on any platform. The grid is
+ * written as it is generated, in O(1) memory; the geometric graph keeps the
+ * positions and the neighbours picked, about 32 bytes per location.
+ */
+
+#ifndef GRAPH_GENERATOR_H
+#define GRAPH_GENERATOR_H
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Shape of a generated graph
+ */
+enum class Topology {
+    Grid,       ///< perturbed grid
+    Geometric,  ///< random geometric graph, nearest neighbours
+};
+
+/**
+ * @brief Distribution of the number of neighbours each location of a geometric graph links to
+ */
+enum class DegreeDistribution {
+    Fixed,    ///< the mean, rounded up or down at random
+    Poisson,  ///< Poisson of the mean, at least 1
+};
+
+/**
+ * @brief Options of generateGraph
+ */
+struct GeneratorOptions {
+    long long nodes = 10000;
+    Topology topology = Topology::Grid;
+    double degree = 3.0;          ///< mean roads per location (Porto: 3.0), at most 6 for a grid, within a few % for a geometric graph
+    DegreeDistribution degreeDistribution = DegreeDistribution::Poisson;
+    double parking = 0.055;       ///< share of locations with parking (Porto: 5.5%)
+    double drivingOnly = 0.0;     ///< share of roads with X walking time
+    double walkingOnly = 0.05;    ///< share of roads with X driving time (Porto: 4.9%)
+    uint64_t seed = 1;
+};
+
+/**
+ * @brief What generateGraph wrote
+ */
+struct GeneratorStats {
+    long long nodes = 0;
+    long long roads = 0;
+    long long parking = 0;
+    long long drivingOnly = 0;
+    long long walkingOnly = 0;
+};
+
+/**
+ * @brief Parses a topology name: "grid" or "geometric"
+ * @return false if the name is unknown
+ */
+inline bool parseTopology(const std::string &name, Topology &topology) {
+    if (name == "grid") {
+        topology = Topology::Grid;
+    } else if (name == "geometric") {
+        topology = Topology::Geometric;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a degree distribution name: "fixed" or "poisson"
+ * @return false if the name is unknown
+ */
+inline bool parseDegreeDistribution(const std::string &name, DegreeDistribution &distribution) {
+    if (name == "fixed") {
+        distribution = DegreeDistribution::Fixed;
+    } else if (name == "poisson") {
+        distribution = DegreeDistribution::Poisson;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Uniform number in [0, 1) for a seed, two keys and a purpose
+ * @details splitmix64 of the inputs, the same on every platform.
+ */
+inline double unitHash(uint64_t seed, uint64_t a, uint64_t b, uint64_t salt) {
+    uint64_t x = 0;
+    for (uint64_t k : {seed, a, b, salt}) {
+        x += 0x9e3779b97f4a7c15ull + k;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x ^= x >> 31;
+    }
+    return (double) (x >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @class CsvBuffer
+ * @brief Output file written in large blocks
+ */
+class CsvBuffer {
+public:
+    explicit CsvBuffer(const std::string &fileName) : file(fileName, std::ios::binary) { buffer.reserve(1 << 20); }
+    ~CsvBuffer() { flush(); }
+
+    bool isOpen() const { return file.is_open(); }
+
+    CsvBuffer &operator<<(const char *text) {
+        buffer += text;
+        return *this;
+    }
+
+    CsvBuffer &operator<<(long long value) {
+        char digits[24];
+        buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+        if (buffer.size() >= (1 << 20)) flush();
+        return *this;
+    }
+
+    /**
+     * @brief Writes the buffered text
+     * @return false if this or an earlier write failed
+     */
+    bool flush() {
+        file.write(buffer.data(), (std::streamsize) buffer.size());
+        buffer.clear();
+        return file.flush().good();
+    }
+
+private:
+    std::ofstream file;
+    std::string buffer;
+};
+
+/**
+ * @brief Writes one road of Distances.csv, between the locations of IDs a and b
+ * @param length Length of the road, in blocks
+ */
+inline void writeRoad(CsvBuffer &out, const GeneratorOptions &options, GeneratorStats &stats, long long a,
+                      long long b, double length) {
+    double kind = unitHash(options.seed, a, b, 1);
+    long long driving = std::max(1LL, std::llround(length * 6 * (0.6 + 0.8 * unitHash(options.seed, a, b, 2))));
+    long long walking = std::max(1LL, std::llround(length * 32 * (0.8 + 0.4 * unitHash(options.seed, a, b, 3))));
+    out << "S" << a << ",S" << b << ",";
+    if (kind < options.walkingOnly) {
+        out << "X";
+        stats.walkingOnly++;
+    } else {
+        out << driving;
+    }
+    out << ",";
+    if (kind >= options.walkingOnly && kind < options.walkingOnly + options.drivingOnly) {
+        out << "X";
+        stats.drivingOnly++;
+    } else {
+        out << walking;
+    }
+    out << "\n";
+    stats.roads++;
+}
+
+/**
+ * @brief Writes the roads of a perturbed grid
+ *
+ * @details Location v (from 0) is the corner (v % side, v / side), moved by up to 0.3
+ * in each direction. Up to degree 4, each street to the right and down is kept
+ * with probability degree/4; above it, every street is kept and each block gets
+ * one of its diagonals with probability (degree-4)/2.
+ */
+inline void writeGridRoads(CsvBuffer &out, const GeneratorOptions &options, GeneratorStats &stats) {
+    long long n = options.nodes;
+    long long side = std::max(1LL, (long long) std::ceil(std::sqrt((double) n)));
+    double keep = std::min(1.0, options.degree / 4);
+    double diagonal = std::clamp((options.degree - 4) / 2, 0.0, 1.0);
+    auto x = [&](long long v) { return v % side + 0.6 * (unitHash(options.seed, v, 0, 4) - 0.5); };
+    auto y = [&](long long v) { return v / side + 0.6 * (unitHash(options.seed, v, 0, 5) - 0.5); };
+    auto road = [&](long long a, long long b) {
+        writeRoad(out, options, stats, a + 1, b + 1, std::hypot(x(a) - x(b), y(a) - y(b)));
+    };
+    for (long long v = 0; v < n; v++) {
+        bool right = v % side + 1 < side && v + 1 < n;
+        bool down = v + side < n;
+        if (right && unitHash(options.seed, v, 0, 6) < keep) road(v, v + 1);
+        if (down && unitHash(options.seed, v, 0, 7) < keep) road(v, v + side);
+        if (right && v + side + 1 < n && unitHash(options.seed, v, 0, 8) < diagonal) {
+            if (unitHash(options.seed, v, 0, 9) < 0.5) {
+                road(v, v + side + 1);
+            } else {
+                road(v + 1, v + side);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Number of nearest neighbours location v links to in a geometric graph
+ * @param mean Mean of the distribution
+ */
+inline int geometricLinks(const GeneratorOptions &options, double mean, long long v) {
+    int k;
+    if (options.degreeDistribution == DegreeDistribution::Fixed) {
+        k = (int) mean + (unitHash(options.seed, v, 0, 10) < mean - std::floor(mean));
+    } else {
+        double limit = std::exp(-mean), p = 1;
+        k = -1;
+        do {
+            p *= unitHash(options.seed, v, ++k, 11);
+        } while (p > limit && k < 64);
+    }
+    return std::clamp(k, 1, 32);
+}
+
+/**
+ * @brief Writes the roads of a random geometric graph
+ *
+ * @details Locations are spread uniformly over a square of area nodes, so one
+ * location per unit of area. Each is linked to its k nearest neighbours
+ * (geometricLinks), found in a grid of unit cells; a pair that picked each other
+ * is written once. Since many picks are mutual, the neighbours are picked twice:
+ * with a mean of degree/2, then with that mean scaled by how far the roads
+ * obtained were from degree.
+ */
+inline void writeGeometricRoads(CsvBuffer &out, const GeneratorOptions &options, GeneratorStats &stats) {
+    uint32_t n = (uint32_t) options.nodes;
+    double side = std::sqrt((double) n);
+    uint32_t cellsPerSide = std::max(1u, (uint32_t) std::ceil(side));
+    std::vector<float> xs(n), ys(n);
+    for (uint32_t v = 0; v < n; v++) {
+        xs[v] = (float) (unitHash(options.seed, v, 0, 12) * side);
+        ys[v] = (float) (unitHash(options.seed, v, 0, 13) * side);
+    }
+    auto cellOf = [&](uint32_t v) {
+        uint32_t cx = std::min(cellsPerSide - 1, (uint32_t) xs[v]);
+        uint32_t cy = std::min(cellsPerSide - 1, (uint32_t) ys[v]);
+        return (uint64_t) cy * cellsPerSide + cx;
+    };
+    // locations sorted by cell (counting sort)
+    std::vector<uint32_t> cellStart((uint64_t) cellsPerSide * cellsPerSide + 1, 0), order(n);
+    for (uint32_t v = 0; v < n; v++) cellStart[cellOf(v) + 1]++;
+    for (size_t c = 1; c < cellStart.size(); c++) cellStart[c] += cellStart[c - 1];
+    {
+        std::vector<uint32_t> next(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t v = 0; v < n; v++) order[next[cellOf(v)]++] = v;
+    }
+
+    std::vector<uint64_t> pickStart(n + 1, 0);
+    std::vector<uint32_t> picks;
+    std::vector<std::pair<float, uint32_t>> best;
+    auto pickNeighbours = [&](double mean) {
+        for (uint32_t v = 0; v < n; v++) {
+            pickStart[v + 1] = pickStart[v] + std::min<size_t>(geometricLinks(options, mean, v), n - 1);
+        }
+        picks.resize(pickStart[n]);
+        for (uint32_t v : order) { // in cell order, so neighbouring cells are in cache
+            size_t k = pickStart[v + 1] - pickStart[v];
+            if (k == 0) continue; // a single location
+            long long cx = std::min(cellsPerSide - 1, (uint32_t) xs[v]);
+            long long cy = std::min(cellsPerSide - 1, (uint32_t) ys[v]);
+            best.clear();
+            for (long long r = 0; r <= cellsPerSide; r++) {
+                for (long long y = cy - r; y <= cy + r; y++) {
+                    if (y < 0 || y >= cellsPerSide) continue;
+                    bool edgeRow = y == cy - r || y == cy + r;
+                    for (long long x = cx - r; x <= cx + r; x += edgeRow ? 1 : 2 * std::max(r, 1LL)) {
+                        if (x < 0 || x >= cellsPerSide) continue;
+                        uint64_t c = (uint64_t) y * cellsPerSide + x;
+                        for (uint32_t i = cellStart[c]; i < cellStart[c + 1]; i++) {
+                            uint32_t u = order[i];
+                            if (u == v) continue;
+                            float d = std::hypot(xs[u] - xs[v], ys[u] - ys[v]);
+                            if (best.size() == k && !(std::make_pair(d, u) < best.back())) continue;
+                            if (best.size() == k) best.pop_back();
+                            best.insert(std::upper_bound(best.begin(), best.end(), std::make_pair(d, u)), {d, u});
+                        }
+                    }
+                }
+                if (best.size() == k && best.back().first <= r) break; // farther cells are at least r away
+            }
+            for (size_t i = 0; i < k; i++) picks[pickStart[v] + i] = best[i].second;
+        }
+    };
+
+    auto picked = [&](uint32_t u, uint32_t v) {
+        return std::find(picks.begin() + pickStart[u], picks.begin() + pickStart[u + 1], v) != picks.begin() + pickStart[u + 1];
+    };
+    auto countRoads = [&]() {
+        uint64_t roads = picks.size();
+        for (uint32_t v = 0; v < n; v++) {
+            for (uint64_t i = pickStart[v]; i < pickStart[v + 1]; i++) roads -= picks[i] < v && picked(picks[i], v);
+        }
+        return roads;
+    };
+    double mean = options.degree / 2;
+    pickNeighbours(mean);
+    uint64_t roads = countRoads();
+    if (roads > 0) pickNeighbours(mean * options.degree * n / (2.0 * roads));
+    for (uint32_t v = 0; v < n; v++) {
+        for (uint64_t i = pickStart[v]; i < pickStart[v + 1]; i++) {
+            uint32_t u = picks[i];
+            if (u < v && picked(u, v)) continue; // written from u
+            writeRoad(out, options, stats, v + 1, u + 1, std::hypot(xs[u] - xs[v], ys[u] - ys[v]));
+        }
+    }
+}
+
+/**
+ * @brief Writes folder/Locations.csv and folder/Distances.csv
+ * @param folder Existing folder
+ * @param options Size, topology, degree, parking and X edge shares, seed
+ * @param stats Output: counts of what was written
+ * @return false if a file could not be written, or the options are out of range
+ */
+inline bool generateGraph(const std::string &folder, const GeneratorOptions &options, GeneratorStats &stats) {
+    stats = GeneratorStats();
+    if (options.nodes < 1 || options.nodes > 2000000000LL) {
+        std::cerr << "Error: The number of nodes must be between 1 and 2000000000" << std::endl;
+        return false;
+    }
+    if (options.degree <= 0 || options.parking < 0 || options.drivingOnly < 0 || options.walkingOnly < 0
+        || options.drivingOnly + options.walkingOnly > 1) {
+        std::cerr << "Error: Invalid degree, parking or X edge share" << std::endl;
+        return false;
+    }
+
+    CsvBuffer locations(folder + "/Locations.csv");
+    CsvBuffer distances(folder + "/Distances.csv");
+    if (!locations.isOpen() || !distances.isOpen()) {
+        std::cerr << "Error: Could not write to folder " << folder << std::endl;
+        return false;
+    }
+    locations << "Location,Id,Code,Parking\n";
+    for (long long v = 1; v <= options.nodes; v++) {
+        bool parking = unitHash(options.seed, v, 0, 0) < options.parking;
+        locations << "SYNTHETIC " << v << "," << v << ",S" << v << "," << (long long) parking << "\n";
+        stats.parking += parking;
+    }
+    stats.nodes = options.nodes;
+
+    distances << "Location1,Location2,Driving,Walking\n";
+    if (options.topology == Topology::Grid) {
+        writeGridRoads(distances, options, stats);
+    } else {
+        writeGeometricRoads(distances, options, stats);
+    }
+    if (!locations.flush() || !distances.flush()) {
+        std::cerr << "Error: Could not write to folder " << folder << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif //GRAPH_GENERATOR_H
@@ -0,0 +1,440 @@
+/**
+ * @file allpairs.h
+ * @brief Precomputed costs and routes between every pair of vertices
+ *
+ * @details For a city sized graph (about a thousand vertices) the whole n x n table
+ * fits in a few megabytes, and every unrestricted query becomes a lookup: the cost
+ * in O(1), the route in O(route length) by following predecessors back from the
+ * destination. The tables are computed by one of:
+ * - Floyd-Warshall, in 64 x 64 blocks so each step works on three blocks that stay
+ *   in cache, the blocks of a step spread over threads;
+ * - one full dijkstra per vertex, spread over threads.
+ * Floyd-Warshall costs n^3 whatever the edges, the searches about n (n + m) log n,
+ * so the choice depends on the density of the graph.
+ * The tables are saved next to the graph snapshot (allpairs.bin) and mapped back
+ * on the next run, as long as the graph has not changed.
+ */
+
+#ifndef ALLPAIRS_H
+#define ALLPAIRS_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "driving.h"
+#include "../data_structures/graphSnapshot.h"
+#include "../data_structures/MappedFile.h"
+#include "../data_structures/ParallelFor.h"
+
+/**
+ * @brief Algorithms that can fill AllPairs
+ */
+enum class AllPairsMethod {
+    Auto,           ///< picked from the density of the graph
+    FloydWarshall,  ///< blocked Floyd-Warshall
+    Dijkstra        ///< one dijkstra per vertex
+};
+
+/**
+ * @brief Reads an all-pairs method name
+ * @param name "auto", "floyd" or "dijkstra"
+ * @param method Output: the method with that name
+ * @return false if the name is unknown
+ */
+inline bool parseAllPairsMethod(const std::string &name, AllPairsMethod &method) {
+    if (name == "auto") {
+        method = AllPairsMethod::Auto;
+    } else if (name == "floyd") {
+        method = AllPairsMethod::FloydWarshall;
+    } else if (name == "dijkstra") {
+        method = AllPairsMethod::Dijkstra;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Magic bytes at the start of an all-pairs file
+ */
+inline constexpr char allPairsMagic[8] = {'D', 'A', 'P', 'A', 'I', 'R', 'S', '\0'};
+
+/**
+ * @brief Current version of the all-pairs file format
+ */
+inline constexpr uint32_t allPairsVersion = 1;
+
+/**
+ * @struct AllPairsHeader
+ * @brief First bytes of an all-pairs file, followed by the four tables
+ * (driving costs, driving predecessors, walking costs, walking predecessors),
+ * each n * n int32_t starting at a multiple of snapshotAlignment
+ */
+struct AllPairsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t numVertex;
+    uint64_t fingerprint;   // AllPairs::graphFingerprint of the graph the tables belong to
+    uint32_t method;        // AllPairsMethod that computed them
+    uint32_t padding;
+};
+
+/**
+ * @class AllPairs
+ * @brief Cost and predecessor tables of every pair of vertices, for driving and walking
+ * @tparam T Type of vertex information
+ *
+ * @details Tables are stored by source ([s * n + t]) as int32_t: the cost, -1 if t
+ * can't be reached from s, and the vertex before t on the route, -1 for s itself or
+ * an unreachable t. They either live in vectors or in a mapped allpairs.bin.
+ * Routes follow the same rules as dijkstra without restrictions.
+ */
+template <class T>
+class AllPairs {
+public:
+    AllPairs() = default;
+    AllPairs(const AllPairs &) = delete;
+    AllPairs &operator=(const AllPairs &) = delete;
+    AllPairs(AllPairs &&) = default;
+    AllPairs &operator=(AllPairs &&) = default;
+
+    /**
+     * @brief Computes the tables of a graph
+     * @param g The graph snapshot
+     * @param method Algorithm, Auto to pick it from the density of the graph
+     * @param threads Maximum number of threads
+     */
+    AllPairs(const CSRGraph<T> &g, AllPairsMethod method, unsigned threads);
+
+    /**
+     * @brief Maps tables saved by save()
+     * @param fileName Path of the file
+     * @param g The graph the tables must belong to
+     * @return false if the file is missing, of another format, of another graph, or
+     * holds a cost or predecessor out of range (checked once, in O(n^2))
+     */
+    bool load(const std::string &fileName, const CSRGraph<T> &g);
+
+    /**
+     * @brief Writes the tables, next to their final name and then renamed
+     * @param fileName Path of the file
+     * @return true if the file was written
+     */
+    bool save(const std::string &fileName) const;
+
+    /**
+     * @brief Gets the cost of the best route between two vertices
+     * @param s Vertex index of the source
+     * @param t Vertex index of the destination
+     * @param walking false to use driving times, true to use walking times
+     * @return The cost, INF_DIST if there is no route
+     */
+    int getDist(int s, int t, bool walking) const;
+
+    /**
+     * @brief Gets the best route between two vertices
+     * @param g The graph the tables belong to
+     * @param source ID of the source vertex
+     * @param dest ID of the destination vertex
+     * @param walking false to use driving times, true to use walking times
+     * @param route Output: IDs of the vertices of the route, empty if there is none
+     * @return Cost of the route, INF_DIST if there is none
+     */
+    int query(const CSRGraph<T> &g, const T &source, const T &dest, bool walking, std::vector<T> &route) const;
+
+    /**
+     * @brief Checks if the tables were computed or loaded
+     */
+    bool empty() const;
+
+    /**
+     * @brief Gets the algorithm that computed the tables
+     */
+    AllPairsMethod getMethod() const;
+
+    /**
+     * @brief Picks the cheaper algorithm for a graph
+     * @return FloydWarshall for dense graphs, Dijkstra for sparse ones like road maps
+     */
+    static AllPairsMethod chooseMethod(const CSRGraph<T> &g);
+
+    /**
+     * @brief Hash of the edges, weights and vertex states of a graph
+     */
+    static uint64_t graphFingerprint(const CSRGraph<T> &g);
+
+protected:
+    int n = 0;
+    AllPairsMethod method = AllPairsMethod::Auto;
+    uint64_t fingerprint = 0;
+    std::vector<int32_t> owned[2][2];        // [walking][0: costs, 1: predecessors], when computed
+    std::span<const int32_t> tables[2][2];   // [walking][0: costs, 1: predecessors]
+    std::shared_ptr<MappedFile> file;        // when loaded
+
+    static const int blockSize = 64;
+
+    void floydWarshall(const CSRGraph<T> &g, bool walking, unsigned threads,
+                       std::vector<int32_t> &dist, std::vector<int32_t> &pred) const;
+    void dijkstras(const CSRGraph<T> &g, bool walking, unsigned threads,
+                   std::vector<int32_t> &dist, std::vector<int32_t> &pred) const;
+};
+
+template <class T>
+AllPairs<T>::AllPairs(const CSRGraph<T> &g, AllPairsMethod method, unsigned threads)
+    : n(g.getNumVertex()), method(method == AllPairsMethod::Auto ? chooseMethod(g) : method),
+      fingerprint(graphFingerprint(g)) {
+    for (int walking = 0; walking < 2; walking++) {
+        std::vector<int32_t> &dist = owned[walking][0];
+        std::vector<int32_t> &pred = owned[walking][1];
+        if (this->method == AllPairsMethod::FloydWarshall) {
+            floydWarshall(g, walking, threads, dist, pred);
+        } else {
+            dijkstras(g, walking, threads, dist, pred);
+        }
+        tables[walking][0] = dist;
+        tables[walking][1] = pred;
+    }
+}
+
+template <class T>
+AllPairsMethod AllPairs<T>::chooseMethod(const CSRGraph<T> &g) {
+    double n = g.getNumVertex();
+    double m = g.getNumEdges();
+    // a heap operation costs several times a Floyd-Warshall step
+    double searches = 8 * n * (n + m) * std::log2(n + 2);
+    return n * n * n < searches ? AllPairsMethod::FloydWarshall : AllPairsMethod::Dijkstra;
+}
+
+template <class T>
+uint64_t AllPairs<T>::graphFingerprint(const CSRGraph<T> &g) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    auto add = [&hash](int64_t x) {
+        for (int b = 0; b < 8; b++) {
+            hash ^= (uint64_t) (x >> (8 * b)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    add(g.getNumVertex());
+    add(g.getNumEdges());
+    for (int v = 0; v < g.getNumVertex(); v++) {
+        add(g.getInfo(v));
+        add(g.getAvailable(v));
+        add(g.outEnd(v));
+    }
+    for (int e = 0; e < g.getNumEdges(); e++) {
+        add(g.getDest(e));
+        add(g.getDrivingTime(e));
+        add(g.getWalkingTime(e));
+    }
+    return hash;
+}
+
+template <class T>
+void AllPairs<T>::floydWarshall(const CSRGraph<T> &g, bool walking, unsigned threads,
+                                std::vector<int32_t> &dist, std::vector<int32_t> &pred) const {
+    const int32_t inf = INT32_MAX / 2; // inf + inf doesn't overflow
+    dist.assign((size_t) n * n, inf);
+    pred.assign((size_t) n * n, -1);
+    for (int v = 0; v < n; v++) dist[(size_t) v * n + v] = 0;
+    for (int e = 0; e < g.getNumEdges(); e++) {
+        int w = walking ? g.getWalkingTime(e) : g.getDrivingTime(e);
+        int u = g.getOrig(e);
+        int v = g.getDest(e);
+        if (w == -1 || g.getAvailable(u) == -1 || g.getAvailable(v) == -1) continue;
+        if (w < dist[(size_t) u * n + v]) {
+            dist[(size_t) u * n + v] = w;
+            pred[(size_t) u * n + v] = u;
+        }
+    }
+
+    // relaxes the block (bi, bj) through the vertices of block bk
+    auto relaxBlock = [&](int bi, int bj, int bk) {
+        int iEnd = std::min(n, (bi + 1) * blockSize);
+        int jBegin = bj * blockSize, jEnd = std::min(n, (bj + 1) * blockSize);
+        int kEnd = std::min(n, (bk + 1) * blockSize);
+        for (int k = bk * blockSize; k < kEnd; k++) {
+            const int32_t *distK = dist.data() + (size_t) k * n;
+            const int32_t *predK = pred.data() + (size_t) k * n;
+            for (int i = bi * blockSize; i < iEnd; i++) {
+                int32_t ik = dist[(size_t) i * n + k];
+                if (ik == inf) continue;
+                int32_t *distI = dist.data() + (size_t) i * n;
+                int32_t *predI = pred.data() + (size_t) i * n;
+                for (int j = jBegin; j < jEnd; j++) {
+                    if (ik + distK[j] < distI[j]) {
+                        distI[j] = ik + distK[j];
+                        predI[j] = predK[j];
+                    }
+                }
+            }
+        }
+    };
+
+    int blocks = (n + blockSize - 1) / blockSize;
+    for (int bk = 0; bk < blocks; bk++) {
+        relaxBlock(bk, bk, bk);
+        parallelFor(blocks, threads, [&](size_t b) { // the row and the column of bk
+            if ((int) b == bk) return;
+            relaxBlock(bk, b, bk);
+            relaxBlock(b, bk, bk);
+        });
+        parallelFor(blocks, threads, [&](size_t bi) { // everything else, by rows of blocks
+            if ((int) bi == bk) return;
+            for (int bj = 0; bj < blocks; bj++) {
+                if (bj != bk) relaxBlock(bi, bj, bk);
+            }
+        });
+    }
+    for (int32_t &d : dist) {
+        if (d == inf) d = -1;
+    }
+}
+
+template <class T>
+void AllPairs<T>::dijkstras(const CSRGraph<T> &g, bool walking, unsigned threads,
+                            std::vector<int32_t> &dist, std::vector<int32_t> &pred) const {
+    dist.assign((size_t) n * n, -1);
+    pred.assign((size_t) n * n, -1);
+    parallelFor(n, threads, [&](size_t s) {
+        SearchContext &ctx = threadContext(0);
+        dijkstra(g, g.getInfo(s), walking, ctx);
+        int32_t *distS = dist.data() + s * n;
+        int32_t *predS = pred.data() + s * n;
+        for (int v = 0; v < n; v++) {
+            if (ctx.getDist(v) == INF_DIST) continue;
+            distS[v] = ctx.getDist(v);
+            predS[v] = ctx.getPath(v) == -1 ? -1 : g.getOrig(ctx.getPath(v));
+        }
+    });
+}
+
+template <class T>
+bool AllPairs<T>::load(const std::string &fileName, const CSRGraph<T> &g) {
+    auto mapped = std::make_shared<MappedFile>(fileName);
+    if (!mapped->isOpen() || mapped->size() < sizeof(AllPairsHeader)) return false;
+    AllPairsHeader header;
+    memcpy(&header, mapped->data(), sizeof(header));
+    if (memcmp(header.magic, allPairsMagic, sizeof(header.magic)) != 0 || header.version != allPairsVersion ||
+        header.byteOrder != snapshotByteOrder || header.numVertex != (uint64_t) g.getNumVertex() ||
+        header.fingerprint != graphFingerprint(g) || header.method > (uint32_t) AllPairsMethod::Dijkstra) {
+        return false;
+    }
+    uint64_t cells = header.numVertex * header.numVertex;
+    uint64_t tableBytes = (cells * sizeof(int32_t) + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+    uint64_t first = snapshotAlignment;
+    if (mapped->size() < first + 4 * tableBytes) return false;
+
+    int vertices = g.getNumVertex();
+    for (int i = 0; i < 4; i++) {
+        const int32_t *table = reinterpret_cast<const int32_t *>(mapped->data() + first + i * tableBytes);
+        int32_t high = i % 2 ? vertices - 1 : INT32_MAX; // predecessors are vertex indices
+        for (uint64_t c = 0; c < cells; c++) {
+            if (table[c] < -1 || table[c] > high) return false;
+        }
+    }
+
+    n = vertices;
+    method = (AllPairsMethod) header.method;
+    fingerprint = header.fingerprint;
+    for (int i = 0; i < 4; i++) {
+        const char *data = mapped->data() + first + i * tableBytes;
+        tables[i / 2][i % 2] = std::span<const int32_t>(reinterpret_cast<const int32_t *>(data), cells);
+        std::vector<int32_t>().swap(owned[i / 2][i % 2]);
+    }
+    file = mapped;
+    return true;
+}
+
+template <class T>
+bool AllPairs<T>::save(const std::string &fileName) const {
+    AllPairsHeader header{};
+    memcpy(header.magic, allPairsMagic, sizeof(header.magic));
+    header.version = allPairsVersion;
+    header.byteOrder = snapshotByteOrder;
+    header.numVertex = n;
+    header.fingerprint = fingerprint;
+    header.method = (uint32_t) method;
+    static_assert(sizeof(AllPairsHeader) <= snapshotAlignment, "the tables start at snapshotAlignment");
+
+    std::string tmpName = temporaryFileName(fileName);
+    if (tmpName.empty()) {
+        std::cerr << "Error: Could not create a temporary file next to " << fileName << std::endl;
+        return false;
+    }
+    std::error_code ec;
+    std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file " << tmpName << std::endl;
+        std::filesystem::remove(tmpName, ec);
+        return false;
+    }
+    const char padding[snapshotAlignment] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(padding, snapshotAlignment - sizeof(header));
+    for (int i = 0; i < 4; i++) {
+        std::span<const int32_t> table = tables[i / 2][i % 2];
+        out.write(reinterpret_cast<const char *>(table.data()), table.size_bytes());
+        out.write(padding, (snapshotAlignment - table.size_bytes() % snapshotAlignment) % snapshotAlignment);
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Could not write file " << tmpName << std::endl;
+        std::filesystem::remove(tmpName, ec);
+        return false;
+    }
+
+    std::filesystem::rename(tmpName, fileName, ec);
+    if (ec) {
+        std::cerr << "Error: Could not write file " << fileName << std::endl;
+        std::filesystem::remove(tmpName, ec);
+        return false;
+    }
+    return true;
+}
+
+template <class T>
+int AllPairs<T>::getDist(int s, int t, bool walking) const {
+    int32_t d = tables[walking][0][(size_t) s * n + t];
+    return d == -1 ? INF_DIST : d;
+}
+
+template <class T>
+int AllPairs<T>::query(const CSRGraph<T> &g, const T &source, const T &dest, bool walking, std::vector<T> &route) const {
+    route.clear();
+    int s = g.findIdx(source);
+    int t = g.findIdx(dest);
+    if (s == -1 || t == -1 || empty()) return INF_DIST;
+    int cost = getDist(s, t, walking);
+    if (cost == INF_DIST) return INF_DIST;
+
+    const int32_t *pred = tables[walking][1].data() + (size_t) s * n;
+    for (int v = t; v != -1 && (int) route.size() <= n; v = v == s ? -1 : pred[v]) {
+        route.push_back(g.getInfo(v));
+    }
+    reverse(route.begin(), route.end());
+    if (route.front() != source) { // broken chain, only possible with a corrupted file (a cycle)
+        route.clear();
+        return INF_DIST;
+    }
+    return cost;
+}
+
+template <class T>
+bool AllPairs<T>::empty() const {
+    return tables[0][0].empty();
+}
+
+template <class T>
+AllPairsMethod AllPairs<T>::getMethod() const {
+    return method;
+}
+
+#endif //ALLPAIRS_H
@@ -0,0 +1,253 @@
+/**
+ * @file alt.h
+ * @brief ALT search: A* with landmark lower bounds (triangle inequality)
+ *
+ * @details The locations have no coordinates, so A* can't use a geometric
+ * estimate. Instead, the distances from and to a few landmarks are computed
+ * once per graph, and for any vertex v and target t
+ *     d(v,t) >= d(L,t) - d(L,v)   and   d(v,t) >= d(v,L) - d(t,L)
+ * give a lower bound that steers the search towards t.
+ */
+
+#ifndef ALT_H
+#define ALT_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "driving.h"
+
+/**
+ * @class Landmarks
+ * @brief Landmarks of a graph and their distance tables, for driving and walking
+ *
+ * @details Tables are stored per vertex ([v * k + l]), so the bound of a vertex
+ * reads one contiguous block. Distances are whole minutes, kept as int32_t with
+ * -1 for "unreachable". Avoided vertices and edges only make routes longer, so
+ * the bounds stay valid for any RouteOverlay.
+ */
+template <class T>
+class Landmarks {
+public:
+    Landmarks() = default;
+
+    /**
+     * @brief Picks up to k landmarks and computes their distance tables
+     * @param g The graph snapshot
+     * @param k Number of landmarks
+     *
+     * @details Farthest selection: the first landmark is the vertex farthest (driving)
+     * from vertex 0, each next one the vertex farthest from all the landmarks already
+     * picked. This spreads them on the border of the map, where bounds are tightest.
+     * Costs four searches per landmark (two metrics, both directions).
+     */
+    Landmarks(const CSRGraph<T> &g, unsigned k);
+
+    /**
+     * @brief Gets the vertex indices of the landmarks, in selection order
+     */
+    const std::vector<int> &getLandmarks() const;
+
+    /**
+     * @brief Lower bound of the cost from one vertex to another
+     * @param v Vertex index
+     * @param t Vertex index of the target
+     * @param walking false to use driving times, true to use walking times
+     * @return A value that is never above the cost of the best route from v to t
+     */
+    int lowerBound(int v, int t, bool walking) const;
+
+    /**
+     * @brief Gets the memory used by the tables of one landmark, in bytes
+     */
+    std::size_t bytesPerLandmark() const;
+
+protected:
+    int n = 0;
+    std::vector<int> landmarks;
+    std::vector<int32_t> from[2]; // d(L, v), [walking][v * k + l]
+    std::vector<int32_t> to[2];   // d(v, L), [walking][v * k + l]
+};
+
+template <class T>
+Landmarks<T>::Landmarks(const CSRGraph<T> &g, unsigned k) : n(g.getNumVertex()) {
+    if (n == 0 || k == 0) return;
+    if (k > (unsigned) n) k = n;
+
+    SearchContext ctx;
+    std::vector<std::vector<int32_t>> tables[2][2]; // [walking][reverse][landmark]
+    std::vector<int> closest(n, INF_DIST); // driving distance from the nearest landmark
+    RouteOverlay none;
+
+    dijkstra(g, none, g.getInfo(0), false, ctx);
+    int next = 0;
+    for (int v = 0; v < n; v++) {
+        if (ctx.getDist(v) != INF_DIST && ctx.getDist(v) > ctx.getDist(next)) next = v;
+    }
+
+    while (landmarks.size() < k) {
+        landmarks.push_back(next);
+        for (int walking = 0; walking < 2; walking++) {
+            for (int reverse = 0; reverse < 2; reverse++) {
+                if (reverse) {
+                    dijkstraReverse(g, none, g.getInfo(next), walking, ctx);
+                } else {
+                    dijkstra(g, none, g.getInfo(next), walking, ctx);
+                }
+                std::vector<int32_t> table(n);
+                for (int v = 0; v < n; v++) table[v] = ctx.getDist(v) == INF_DIST ? -1 : ctx.getDist(v);
+                tables[walking][reverse].push_back(std::move(table));
+            }
+        }
+
+        const std::vector<int32_t> &d = tables[0][0].back();
+        next = -1;
+        for (int v = 0; v < n; v++) {
+            if (d[v] != -1 && d[v] < closest[v]) closest[v] = d[v];
+            if (closest[v] != INF_DIST && closest[v] > 0 && (next == -1 || closest[v] > closest[next])) next = v;
+        }
+        if (next == -1) break; // every reachable vertex is already a landmark
+    }
+
+    std::size_t count = landmarks.size();
+    for (int walking = 0; walking < 2; walking++) {
+        from[walking].assign(n * count, -1);
+        to[walking].assign(n * count, -1);
+        for (std::size_t l = 0; l < count; l++) {
+            for (int v = 0; v < n; v++) {
+                from[walking][v * count + l] = tables[walking][0][l][v];
+                to[walking][v * count + l] = tables[walking][1][l][v];
+            }
+        }
+    }
+}
+
+template <class T>
+const std::vector<int> &Landmarks<T>::getLandmarks() const {
+    return landmarks;
+}
+
+template <class T>
+int Landmarks<T>::lowerBound(int v, int t, bool walking) const {
+    std::size_t k = landmarks.size();
+    const int32_t *fromV = from[walking].data() + v * k;
+    const int32_t *fromT = from[walking].data() + t * k;
+    const int32_t *toV = to[walking].data() + v * k;
+    const int32_t *toT = to[walking].data() + t * k;
+    int32_t bound = 0;
+    for (std::size_t l = 0; l < k; l++) {
+        if (fromV[l] != -1 && fromT[l] != -1 && fromT[l] - fromV[l] > bound) bound = fromT[l] - fromV[l];
+        if (toV[l] != -1 && toT[l] != -1 && toV[l] - toT[l] > bound) bound = toV[l] - toT[l];
+    }
+    return bound;
+}
+
+template <class T>
+std::size_t Landmarks<T>::bytesPerLandmark() const {
+    return 4 * n * sizeof(int32_t);
+}
+
+/**
+ * @brief Rebuilds the route to t that dijkstra would give, from exact labels
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param s Vertex index of the source
+ * @param t Vertex index of the destination
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Labels, exact for every vertex of every best route to t; the edges
+ * of the route are written with setPath
+ * @return false if dijkstra's route can't be told from the labels alone
+ *
+ * @details dijkstra only replaces a label for a strictly better one, so the
+ * predecessor it keeps is the tight one (dist(u) + w(u,v) == dist(v)) settled
+ * first: the one of smallest dist(u), and the first of its edges to v. When two
+ * predecessors also tie on dist(u), the one settled first depends on the order of
+ * its queue, and false is returned.
+ */
+template <class T>
+bool altPath(const CSRGraph<T> &g, const RouteOverlay &overlay, int s, int t, bool walking, SearchContext &ctx) {
+    int v = t;
+    for (int steps = 0; v != s; steps++) {
+        if (steps == g.getNumVertex()) return false;
+        int best = -1;
+        bool tie = false;
+        for (int r = g.inBegin(v); r < g.inEnd(v); r++) {
+            int e = g.getInEdge(r);
+            int u = g.getOrig(e);
+            int w = walking ? g.getWalkingTime(e) : g.getDrivingTime(e);
+            if (w == -1 || overlay.isEdgeAvoided(e)) continue;
+            if (g.getAvailable(u) == -1 || overlay.isNodeAvoided(u)) continue;
+            if (ctx.getDist(u) == INF_DIST || ctx.getDist(u) + w != ctx.getDist(v)) continue;
+            if (best == -1 || ctx.getDist(u) < ctx.getDist(g.getOrig(best))) {
+                best = e;
+                tie = false;
+            } else if (ctx.getDist(u) == ctx.getDist(g.getOrig(best))) {
+                if (u == g.getOrig(best)) {
+                    best = std::min(best, e);
+                } else {
+                    tie = true;
+                }
+            }
+        }
+        if (best == -1 || tie) return false;
+        ctx.setPath(v, best);
+        v = g.getOrig(best);
+    }
+    return true;
+}
+
+/**
+ * @brief Point-to-point A* over a CSRGraph, guided by landmarks
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param landmarks Landmarks computed for g
+ * @param source ID of the source vertex
+ * @param dest ID of the destination vertex
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Output: labels, final for the destination and enough to rebuild its route
+ * @return false if the route in ctx may differ from dijkstra's (see altPath); the
+ * cost of the destination is right either way
+ *
+ * @details Vertices are extracted by dist + lowerBound. The bounds are consistent,
+ * so a settled vertex is never improved again. The search goes on after the
+ * destination until the keys exceed its cost, so every vertex of every best route
+ * is settled, and the route is then rebuilt with dijkstra's choice of predecessors.
+ */
+template <class T>
+bool altSearch(const CSRGraph<T> &g, const RouteOverlay &overlay, const Landmarks<T> &landmarks,
+               const int &source, const int &dest, bool walking, SearchContext &ctx) {
+    ctx.reset(g.getNumVertex());
+    int s = g.findIdx(source);
+    int t = g.findIdx(dest);
+    if (s == -1 || t == -1) return true;
+    ctx.setDist(s, 0);
+    ctx.setKey(s, landmarks.lowerBound(s, t, walking));
+
+    MutableIndexPriorityQueue<int> &q = ctx.getQueue();
+    q.insert(s);
+    while( ! q.empty() ) {
+        int v = q.extractMin();
+        if (ctx.getKey(v) > ctx.getDist(t)) break; // t is settled, and so is every vertex of its best routes
+        for (int e = g.outBegin(v); e < g.outEnd(v); e++) {
+            int w = g.getDest(e);
+            auto oldDist = ctx.getDist(w);
+            bool relaxed = walking ? relaxwalking(g, overlay, e, ctx) : relaxdriving(g, overlay, e, ctx);
+            if (relaxed) {
+                // mark caches the bound + 1, 0 meaning not computed yet
+                if (!ctx.getMark(w)) ctx.setMark(w, landmarks.lowerBound(w, t, walking) + 1);
+                ctx.setKey(w, ctx.getDist(w) + ctx.getMark(w) - 1);
+                if (oldDist == INF_DIST) {
+                    q.insert(w);
+                }
+                else {
+                    q.decreaseKey(w);
+                }
+            }
+        }
+    }
+    return ctx.getDist(t) == INF_DIST || altPath(g, overlay, s, t, walking, ctx);
+}
+
+#endif //ALT_H
@@ -0,0 +1,124 @@
+/**
+ * @file bidirectional.h
+ * @brief Bidirectional Dijkstra for point-to-point driving and walking routes
+ *
+ * @details Runs a forward search from the source over the outgoing edges and a
+ * backward search from the destination over the incoming edges, until the two
+ * meet. On long queries each side only explores about half of the radius of a
+ * single search.
+ */
+
+#ifndef BIDIRECTIONAL_H
+#define BIDIRECTIONAL_H
+
+#include "driving.h"
+
+/**
+ * @brief Settles the next vertex of one side of a bidirectional search
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param walking false to use driving times, true to use walking times
+ * @param forward true for the search from the source, false for the one from the destination
+ * @param ctx Labels and queue of this side
+ * @param other Labels of the opposite side
+ * @param best In/Out: cost of the best route found so far
+ * @param meet In/Out: vertex index where that route crosses from one side to the other
+ *
+ * @details Edges are checked with relaxdriving/relaxwalking (forward) and relaxreverse
+ * (backward), so the same vertices, edges and metrics are usable as in dijkstra.
+ */
+template <class T>
+void bidirectionalStep(const CSRGraph<T> &g, const RouteOverlay &overlay, bool walking, bool forward,
+                       SearchContext &ctx, const SearchContext &other, int &best, int &meet) {
+    MutableIndexPriorityQueue<int> &q = ctx.getQueue();
+    int v = q.extractMin();
+    int begin = forward ? g.outBegin(v) : g.inBegin(v);
+    int end = forward ? g.outEnd(v) : g.inEnd(v);
+    for (int i = begin; i < end; i++) {
+        int e = forward ? i : g.getInEdge(i);
+        int w = forward ? g.getDest(e) : g.getOrig(e);
+        auto oldDist = ctx.getDist(w);
+        bool relaxed;
+        if (forward) {
+            relaxed = walking ? relaxwalking(g, overlay, e, ctx) : relaxdriving(g, overlay, e, ctx);
+        } else {
+            relaxed = relaxreverse(g, overlay, e, walking, ctx);
+        }
+        if (relaxed) {
+            if (oldDist == INF_DIST) {
+                q.insert(w);
+            }
+            else {
+                q.decreaseKey(w);
+            }
+            if (other.getDist(w) != INF_DIST && ctx.getDist(w) + other.getDist(w) < best) {
+                best = ctx.getDist(w) + other.getDist(w);
+                meet = w;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Bidirectional Dijkstra between two vertices
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param source ID of the source vertex
+ * @param dest ID of the destination vertex
+ * @param walking false to use driving times, true to use walking times
+ * @param route Output: IDs of the vertices of the route, empty if there is none
+ * @param forward Labels of the search from the source
+ * @param backward Labels of the search from the destination
+ * @return Cost of the route, INF_DIST if there is none
+ *
+ * @details Always expands the side with the smaller queue head, and stops once the
+ * two heads add up to at least the best route found, since no route through an
+ * unsettled vertex can be shorter. The route is rebuilt from both sides through the
+ * vertex where they met. Its cost is the same as dijkstra's, but among routes of
+ * equal cost it may pick a different one.
+ */
+template <class T>
+int bidirectionalDijkstra(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, const int &dest,
+                          bool walking, std::vector<T> &route, SearchContext &forward, SearchContext &backward) {
+    route.clear();
+    int s = g.findIdx(source);
+    int t = g.findIdx(dest);
+    if (s == -1 || t == -1) return INF_DIST;
+
+    forward.reset(g.getNumVertex());
+    backward.reset(g.getNumVertex());
+    forward.setDist(s, 0);
+    backward.setDist(t, 0);
+    int best = s == t ? 0 : INF_DIST;
+    int meet = s == t ? s : -1;
+
+    MutableIndexPriorityQueue<int> &qF = forward.getQueue(), &qB = backward.getQueue();
+    qF.insert(s);
+    qB.insert(t);
+    while (!qF.empty() && !qB.empty()) {
+        long topF = forward.getDist(qF.top());
+        long topB = backward.getDist(qB.top());
+        if (topF + topB >= best) break; //no shorter route is left
+        if (topF <= topB) {
+            bidirectionalStep(g, overlay, walking, true, forward, backward, best, meet);
+        } else {
+            bidirectionalStep(g, overlay, walking, false, backward, forward, best, meet);
+        }
+    }
+    if (meet == -1) return INF_DIST;
+
+    for (int v = meet; ; v = g.getOrig(forward.getPath(v))) {
+        route.push_back(g.getInfo(v));
+        if (forward.getPath(v) == -1) break;
+    }
+    reverse(route.begin(), route.end());
+    for (int v = meet; backward.getPath(v) != -1; ) {
+        v = g.getDest(backward.getPath(v));
+        route.push_back(g.getInfo(v));
+    }
+    return best;
+}
+
+#endif //BIDIRECTIONAL_H
@@ -0,0 +1,464 @@
+/**
+ * @file ch.h
+ * @brief Contraction Hierarchies for point-to-point driving and walking routes
+ *
+ * @details Preprocessing contracts the vertices one by one, from the least to the
+ * most important, adding a shortcut u->w through a contracted vertex v whenever
+ * u->v->w is the only shortest way between u and w. A query then only has to go
+ * "up" the hierarchy from both ends, which settles a few dozen vertices instead of
+ * a large part of the map. Shortcuts remember the vertex they skip, so routes are
+ * unpacked into the original vertices.
+ */
+
+#ifndef CH_H
+#define CH_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <queue>
+
+#include "driving.h"
+
+/**
+ * @class ContractionHierarchy
+ * @brief Hierarchy of a CSRGraph for one metric (driving or walking)
+ *
+ * @details Edges with a -1 time for the metric and vertices that are not available
+ * are left out. The hierarchy is static: a query with avoided vertices or segments
+ * must be answered by another engine (see shortestRoute).
+ */
+template <class T>
+class ContractionHierarchy {
+public:
+    ContractionHierarchy() = default;
+
+    /**
+     * @brief Contracts every vertex of a graph
+     * @param g The graph snapshot
+     * @param walking false to use driving times, true to use walking times
+     *
+     * @details Vertices are ordered by edge difference (shortcuts added minus edges
+     * removed) plus the number of neighbours already contracted, updated lazily.
+     * Witness searches are bounded, so a few unnecessary shortcuts may be added,
+     * which never changes the result of a query.
+     */
+    ContractionHierarchy(const CSRGraph<T> &g, bool walking);
+
+    /**
+     * @brief Computes the best route between two vertices
+     * @param g The graph the hierarchy was built from
+     * @param source ID of the source vertex
+     * @param dest ID of the destination vertex
+     * @param route Output: IDs of the vertices of the route, empty if there is none
+     * @return Cost of the route, INF_DIST if there is none
+     */
+    int query(const CSRGraph<T> &g, const T &source, const T &dest, std::vector<T> &route) const;
+
+    /**
+     * @brief Computes the cost between every source and every target
+     * @param g The graph the hierarchy was built from
+     * @param sources Vertex indices of the sources, -1 for a missing one
+     * @param targets Vertex indices of the targets, -1 for a missing one
+     * @param rowSearch void(size_t count, F fn): calls fn(i) for every i < count, possibly in parallel
+     * @param times Output: times[i * targets.size() + j], INF_DIST if there is no route
+     *
+     * @details Bucket based many-to-many: one upward search from every target, on the
+     * reversed hierarchy, leaves (target, cost) in a bucket at every vertex it settles.
+     * The upward search from a source then only has to scan the buckets of the vertices
+     * it settles, since every shortest route meets its target's search at its top vertex.
+     */
+    template <class RowSearch>
+    void table(const CSRGraph<T> &g, const std::vector<int> &sources, const std::vector<int> &targets,
+               RowSearch rowSearch, std::vector<int> &times) const;
+
+    /**
+     * @brief Gets the number of shortcuts added by the preprocessing
+     */
+    int getNumShortcuts() const;
+
+    /**
+     * @brief Checks if the hierarchy was built
+     */
+    bool empty() const;
+
+protected:
+    /**
+     * @brief Edge of the hierarchy
+     */
+    struct Arc {
+        int vertex;  ///< the other end of the edge
+        int weight;
+        int middle;  ///< vertex skipped by a shortcut, -1 for an original edge
+    };
+
+    int n = 0;
+    int shortcuts = 0;
+    std::vector<int> rank;
+    std::vector<int> upOffsets;     ///< edges v->w with rank[w] > rank[v], by v
+    std::vector<Arc> up;
+    std::vector<int> downOffsets;   ///< edges u->v with rank[u] > rank[v], by v (Arc::vertex is u)
+    std::vector<Arc> down;
+
+    int findMiddle(int a, int b) const;
+    void unpack(int a, int b, std::vector<T> &route, const CSRGraph<T> &g) const;
+
+    /**
+     * @brief Full upward search, calling visit(v, cost) for every vertex it settles
+     * @param side 0 to follow up edges from the root, 1 to follow down edges backwards
+     */
+    template <class Visit>
+    void upwardSearch(int side, int root, Visit visit) const;
+};
+
+/**
+ * @brief Preprocessing state of a ContractionHierarchy, dropped once it's built
+ */
+struct CHBuilder {
+    struct Arc {
+        int vertex;
+        int weight;
+        int middle;
+    };
+    std::vector<std::vector<Arc>> out, in;
+    std::vector<char> contracted;
+    std::vector<int> contractedNeighbours;
+    std::vector<int> dist;
+    std::vector<int> touched;
+    static const int settleLimit = 500;
+
+    /**
+     * @brief Adds or shortens the edge u->w
+     * @return true if the graph changed
+     */
+    bool addArc(int u, int w, int weight, int middle) {
+        for (Arc &a : out[u]) {
+            if (a.vertex != w) continue;
+            if (a.weight <= weight) return false;
+            a.weight = weight;
+            a.middle = middle;
+            for (Arc &b : in[w]) {
+                if (b.vertex == u) { b.weight = weight; b.middle = middle; }
+            }
+            return true;
+        }
+        out[u].push_back({w, weight, middle});
+        in[w].push_back({u, weight, middle});
+        return true;
+    }
+
+    /**
+     * @brief Bounded Dijkstra from u that ignores v, to look for witnesses of u->v->w
+     */
+    void witnessSearch(int u, int v, int maxDist) {
+        for (int x : touched) dist[x] = INT_MAX;
+        touched.clear();
+        typedef std::pair<int, int> Item;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> q;
+        dist[u] = 0;
+        touched.push_back(u);
+        q.push({0, u});
+        int settled = 0;
+        while (!q.empty() && settled < settleLimit) {
+            auto [d, x] = q.top();
+            q.pop();
+            if (d > dist[x]) continue;
+            if (d > maxDist) break;
+            settled++;
+            for (const Arc &a : out[x]) {
+                if (a.vertex == v || contracted[a.vertex]) continue;
+                int nd = d + a.weight;
+                if (nd < dist[a.vertex]) {
+                    if (dist[a.vertex] == INT_MAX) touched.push_back(a.vertex);
+                    dist[a.vertex] = nd;
+                    q.push({nd, a.vertex});
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Contracts v, or only counts the shortcuts it would need
+     * @return Number of shortcuts
+     */
+    int contract(int v, bool simulate) {
+        int count = 0;
+        for (const Arc &in_ : in[v]) {
+            int u = in_.vertex;
+            if (contracted[u]) continue;
+            int maxDist = 0;
+            for (const Arc &o : out[v]) {
+                if (!contracted[o.vertex] && o.vertex != u) maxDist = std::max(maxDist, in_.weight + o.weight);
+            }
+            if (maxDist == 0) continue;
+            witnessSearch(u, v, maxDist);
+            for (const Arc &o : out[v]) {
+                int w = o.vertex;
+                if (contracted[w] || w == u) continue;
+                int via = in_.weight + o.weight;
+                if (dist[w] <= via) continue; // witness found
+                count++;
+                if (!simulate) addArc(u, w, via, v);
+            }
+        }
+        return count;
+    }
+
+    int priority(int v) {
+        int degree = 0;
+        for (const Arc &a : in[v]) degree += !contracted[a.vertex];
+        for (const Arc &a : out[v]) degree += !contracted[a.vertex];
+        return contract(v, true) - degree + contractedNeighbours[v];
+    }
+};
+
+template <class T>
+ContractionHierarchy<T>::ContractionHierarchy(const CSRGraph<T> &g, bool walking) : n(g.getNumVertex()) {
+    CHBuilder b;
+    b.out.resize(n);
+    b.in.resize(n);
+    b.contracted.assign(n, 0);
+    b.contractedNeighbours.assign(n, 0);
+    b.dist.assign(n, INT_MAX);
+    for (int e = 0; e < g.getNumEdges(); e++) {
+        int weight = walking ? g.getWalkingTime(e) : g.getDrivingTime(e);
+        int u = g.getOrig(e);
+        int w = g.getDest(e);
+        if (weight == -1 || u == w || g.getAvailable(u) == -1 || g.getAvailable(w) == -1) continue;
+        b.addArc(u, w, weight, -1);
+    }
+
+    typedef std::pair<int, int> Item; // (priority, vertex)
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> order;
+    for (int v = 0; v < n; v++) order.push({b.priority(v), v});
+
+    rank.assign(n, 0);
+    std::vector<std::vector<Arc>> upLists(n), downLists(n);
+    int next = 0;
+    while (!order.empty()) {
+        int v = order.top().second;
+        order.pop();
+        if (b.contracted[v]) continue;
+        int p = b.priority(v);
+        if (!order.empty() && p > order.top().first) { // lazy update
+            order.push({p, v});
+            continue;
+        }
+        shortcuts += b.contract(v, false);
+        for (const auto &a : b.out[v]) {
+            if (b.contracted[a.vertex]) continue;
+            upLists[v].push_back({a.vertex, a.weight, a.middle});
+            b.contractedNeighbours[a.vertex]++;
+        }
+        for (const auto &a : b.in[v]) {
+            if (b.contracted[a.vertex]) continue;
+            downLists[v].push_back({a.vertex, a.weight, a.middle});
+            b.contractedNeighbours[a.vertex]++;
+        }
+        b.contracted[v] = 1;
+        rank[v] = next++;
+    }
+
+    upOffsets.assign(n + 1, 0);
+    downOffsets.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        upOffsets[v + 1] = upOffsets[v] + upLists[v].size();
+        downOffsets[v + 1] = downOffsets[v] + downLists[v].size();
+        up.insert(up.end(), upLists[v].begin(), upLists[v].end());
+        down.insert(down.end(), downLists[v].begin(), downLists[v].end());
+    }
+}
+
+template <class T>
+int ContractionHierarchy<T>::getNumShortcuts() const {
+    return shortcuts;
+}
+
+template <class T>
+bool ContractionHierarchy<T>::empty() const {
+    return rank.empty();
+}
+
+/**
+ * @brief Finds the vertex skipped by the hierarchy edge a->b
+ * @return The vertex, or -1 if a->b is an original edge
+ */
+template <class T>
+int ContractionHierarchy<T>::findMiddle(int a, int b) const {
+    if (rank[a] < rank[b]) {
+        for (int i = upOffsets[a]; i < upOffsets[a + 1]; i++)
+            if (up[i].vertex == b) return up[i].middle;
+    } else {
+        for (int i = downOffsets[b]; i < downOffsets[b + 1]; i++)
+            if (down[i].vertex == a) return down[i].middle;
+    }
+    return -1;
+}
+
+/**
+ * @brief Appends the original vertices of the hierarchy edge a->b, without a
+ */
+template <class T>
+void ContractionHierarchy<T>::unpack(int a, int b, std::vector<T> &route, const CSRGraph<T> &g) const {
+    std::vector<std::pair<int, int>> stack = {{a, b}};
+    while (!stack.empty()) {
+        auto [x, y] = stack.back();
+        stack.pop_back();
+        int m = findMiddle(x, y);
+        if (m == -1) {
+            route.push_back(g.getInfo(y));
+        } else {
+            stack.push_back({m, y});
+            stack.push_back({x, m});
+        }
+    }
+}
+
+template <class T>
+template <class Visit>
+void ContractionHierarchy<T>::upwardSearch(int side, int root, Visit visit) const {
+    struct Workspace {
+        std::vector<int> dist;
+        std::vector<int> touched;
+    };
+    thread_local Workspace ws;
+    if ((int) ws.dist.size() < n) {
+        ws.dist.assign(n, INT_MAX);
+        ws.touched.clear();
+    }
+    for (int x : ws.touched) ws.dist[x] = INT_MAX;
+    ws.touched.clear();
+
+    typedef std::pair<int, int> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> q;
+    ws.dist[root] = 0;
+    ws.touched.push_back(root);
+    q.push({0, root});
+    const std::vector<int> &offsets = side == 0 ? upOffsets : downOffsets;
+    const std::vector<Arc> &arcs = side == 0 ? up : down;
+    while (!q.empty()) {
+        auto [d, v] = q.top();
+        q.pop();
+        if (d > ws.dist[v]) continue;
+        visit(v, d);
+        for (int i = offsets[v]; i < offsets[v + 1]; i++) {
+            int w = arcs[i].vertex;
+            int nd = d + arcs[i].weight;
+            if (nd < ws.dist[w]) {
+                if (ws.dist[w] == INT_MAX) ws.touched.push_back(w);
+                ws.dist[w] = nd;
+                q.push({nd, w});
+            }
+        }
+    }
+}
+
+template <class T>
+template <class RowSearch>
+void ContractionHierarchy<T>::table(const CSRGraph<T> &g, const std::vector<int> &sources,
+                                    const std::vector<int> &targets, RowSearch rowSearch,
+                                    std::vector<int> &times) const {
+    size_t cols = targets.size();
+    times.assign(sources.size() * cols, INF_DIST);
+    auto usable = [&](int v) { return v != -1 && !empty() && g.getAvailable(v) != -1; };
+
+    // buckets[bucketOffsets[v] ..]: (target column, cost from v to it), as a CSR by vertex
+    std::vector<std::vector<std::pair<int, int>>> found(cols);
+    rowSearch(cols, [&](size_t j) {
+        if (!usable(targets[j])) return;
+        upwardSearch(1, targets[j], [&](int v, int d) { found[j].push_back({v, d}); });
+    });
+    std::vector<int> bucketOffsets(n + 1, 0);
+    for (const auto &entries : found) {
+        for (const auto &[v, d] : entries) bucketOffsets[v + 1]++;
+    }
+    for (int v = 0; v < n; v++) bucketOffsets[v + 1] += bucketOffsets[v];
+    std::vector<std::pair<int, int>> buckets(bucketOffsets[n]);
+    std::vector<int> fill(bucketOffsets.begin(), bucketOffsets.end() - 1);
+    for (size_t j = 0; j < cols; j++) {
+        for (const auto &[v, d] : found[j]) buckets[fill[v]++] = {(int) j, d};
+        std::vector<std::pair<int, int>>().swap(found[j]);
+    }
+
+    rowSearch(sources.size(), [&](size_t i) {
+        if (!usable(sources[i])) return;
+        int *row = times.data() + i * cols;
+        upwardSearch(0, sources[i], [&](int v, int d) {
+            for (int b = bucketOffsets[v]; b < bucketOffsets[v + 1]; b++) {
+                auto [j, rest] = buckets[b];
+                if (d + rest < row[j]) row[j] = d + rest;
+            }
+        });
+    });
+}
+
+template <class T>
+int ContractionHierarchy<T>::query(const CSRGraph<T> &g, const T &source, const T &dest, std::vector<T> &route) const {
+    route.clear();
+    int s = g.findIdx(source);
+    int t = g.findIdx(dest);
+    if (s == -1 || t == -1 || empty()) return INF_DIST;
+    if (g.getAvailable(s) == -1 || g.getAvailable(t) == -1) return INF_DIST;
+
+    // Labels are reset through the touched lists, so a query costs what it settles, not O(n)
+    struct Workspace {
+        std::vector<int> dist[2], parent[2];
+        std::vector<int> touched[2];
+    };
+    thread_local Workspace ws;
+    for (int side = 0; side < 2; side++) {
+        if ((int) ws.dist[side].size() < n) {
+            ws.dist[side].assign(n, INT_MAX);
+            ws.parent[side].assign(n, -1);
+            ws.touched[side].clear();
+        }
+        for (int x : ws.touched[side]) { ws.dist[side][x] = INT_MAX; ws.parent[side][x] = -1; }
+        ws.touched[side].clear();
+    }
+
+    typedef std::pair<int, int> Item;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> q[2];
+    std::vector<int> *dist = ws.dist, *parent = ws.parent;
+    dist[0][s] = 0; ws.touched[0].push_back(s); q[0].push({0, s});
+    dist[1][t] = 0; ws.touched[1].push_back(t); q[1].push({0, t});
+    long best = LONG_MAX;
+    int meet = -1;
+
+    while (true) {
+        int side = -1;
+        for (int k = 0; k < 2; k++) {
+            if (!q[k].empty() && q[k].top().first < best && (side == -1 || q[k].top().first < q[side].top().first)) side = k;
+        }
+        if (side == -1) break; // neither side can improve the best route
+        auto [d, v] = q[side].top();
+        q[side].pop();
+        if (d > dist[side][v]) continue;
+        if (dist[1 - side][v] != INT_MAX && (long) d + dist[1 - side][v] < best) {
+            best = (long) d + dist[1 - side][v];
+            meet = v;
+        }
+        const std::vector<int> &offsets = side == 0 ? upOffsets : downOffsets;
+        const std::vector<Arc> &arcs = side == 0 ? up : down;
+        for (int i = offsets[v]; i < offsets[v + 1]; i++) {
+            int w = arcs[i].vertex;
+            int nd = d + arcs[i].weight;
+            if (nd < dist[side][w]) {
+                if (dist[side][w] == INT_MAX) ws.touched[side].push_back(w);
+                dist[side][w] = nd;
+                parent[side][w] = v;
+                q[side].push({nd, w});
+            }
+        }
+    }
+    if (meet == -1) return INF_DIST;
+
+    std::vector<int> upward; // meet, ..., s
+    for (int v = meet; v != -1; v = parent[0][v]) upward.push_back(v);
+    route.push_back(g.getInfo(s));
+    for (size_t i = upward.size() - 1; i > 0; i--) unpack(upward[i], upward[i - 1], route, g);
+    for (int v = meet; parent[1][v] != -1; v = parent[1][v]) unpack(v, parent[1][v], route, g);
+    return best;
+}
+
+#endif //CH_H
@@ -5,40 +5,52 @@
  * @details Implements Dijkstra's algorithm with dual modes (driving/walking)
  * for urban navigation system. Handles route planning with different
  * constraints for each transportation mode.
+ * Searches run on a CSRGraph and keep their labels in a SearchContext; the
+ * type of the context picks the priority queue they use.
  */
 
 #ifndef DRIVING_H
 #define DRIVING_H
 
 #include "../data_structures/Graph.h"
+#include "../data_structures/CSRGraph.h"
+#include "../data_structures/RouteOverlay.h"
+#include "../data_structures/SearchContext.h"
 
 using namespace std;
 
 /**
  * @brief Relaxation function for driving routes
  * @tparam T Type of vertex information
- * @param edge Pointer to the edge being relaxed
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param edge Id of the (forward) edge being relaxed
+ * @param ctx Labels of the current search
  * @return True if relaxation was successful (shorter path found)
  *
  * @details Checks:
  * - If edge is drivable (drivingTime != -1)
- * - If destination node is available
- * - If origin node is available
+ * - If the overlay avoids the edge
+ * - If destination node is available and not avoided
+ * - If origin node is available and not avoided
  * - If a shorter path is found through this edge
  */
-template <class T>
-bool relaxdriving(Edge<T> *edge) { //for the driving part of the path
+template <class T, class Queue>
+bool relaxdriving(const CSRGraph<T> &g, const RouteOverlay &overlay, int edge, BasicSearchContext<Queue> &ctx) {
 
-    if (edge->getDrivingTime() == -1) {return false;} //can't drive on that edge
+    if (g.getDrivingTime(edge) == -1) {return false;} //can't drive on that edge
 
-    Vertex<T> *v = edge->getDest();
-    if (v->getAvailable() == -1) {return false;}
+    if (overlay.isEdgeAvoided(edge)) {return false;}
 
-    if (edge->getOrig()->getAvailable() == -1) {return false;}
+    int u = g.getOrig(edge);
+    int v = g.getDest(edge);
+    if (g.getAvailable(v) == -1 || overlay.isNodeAvoided(v)) {return false;}
 
-    if (edge->getOrig()->getDist() + edge->getDrivingTime() < edge->getDest()->getDist()) { // we have found a better way to reach v
-        edge->getDest()->setDist(edge->getOrig()->getDist() + edge->getDrivingTime()); // d[v] = d[u] + w(u,v)
-        edge->getDest()->setPath(edge); // set the predecessor of v to u; in this case the edge from u to v
+    if (g.getAvailable(u) == -1 || overlay.isNodeAvoided(u)) {return false;}
+
+    if (ctx.getDist(u) + g.getDrivingTime(edge) < ctx.getDist(v)) { // we have found a better way to reach v
+        ctx.setDist(v, ctx.getDist(u) + g.getDrivingTime(edge)); // d[v] = d[u] + w(u,v)
+        ctx.setPath(v, edge); // set the predecessor of v to u; in this case the edge from u to v
         return true;
     }
     return false;
@@ -47,90 +59,225 @@ bool relaxdriving(Edge<T> *edge) { //for the driving part of the path
 /**
  * @brief Relaxation function for walking routes
  * @tparam T Type of vertex information
- * @param edge Pointer to the edge being relaxed
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param edge Id of the (forward) edge being relaxed
+ * @param ctx Labels of the current search
  * @return True if relaxation was successful (shorter path found)
  *
- * @details Checks:
- * - If edge is walkable (walkingTime != -1)
- * - If destination node is available
- * - If origin node is available
- * - If a shorter path is found through this edge
+ * @details Same checks as relaxdriving, with the walking time of the edge.
  */
-template <class T>
-bool relaxwalking(Edge<T> *edge) { //for the walking part of the path
+template <class T, class Queue>
+bool relaxwalking(const CSRGraph<T> &g, const RouteOverlay &overlay, int edge, BasicSearchContext<Queue> &ctx) {
+
+    if (g.getWalkingTime(edge) == -1) {return false;} //can't walk on that edge
 
-    if (edge->getWalkingTime() == -1) {return false;} //can't drive on that edge
+    if (overlay.isEdgeAvoided(edge)) {return false;}
 
-    Vertex<T> *v = edge->getDest();
-    if (v->getAvailable() == -1) {return false;}
+    int u = g.getOrig(edge);
+    int v = g.getDest(edge);
+    if (g.getAvailable(v) == -1 || overlay.isNodeAvoided(v)) {return false;}
 
-    if (edge->getOrig()->getAvailable() == -1) {return false;}
+    if (g.getAvailable(u) == -1 || overlay.isNodeAvoided(u)) {return false;}
 
-    if (edge->getOrig()->getDist() + edge->getWalkingTime() < edge->getDest()->getDist()) { // we have found a better way to reach v
-        edge->getDest()->setDist(edge->getOrig()->getDist() + edge->getWalkingTime()); // d[v] = d[u] + w(u,v)
-        edge->getDest()->setPath(edge); // set the predecessor of v to u; in this case the edge from u to v
+    if (ctx.getDist(u) + g.getWalkingTime(edge) < ctx.getDist(v)) { // we have found a better way to reach v
+        ctx.setDist(v, ctx.getDist(u) + g.getWalkingTime(edge)); // d[v] = d[u] + w(u,v)
+        ctx.setPath(v, edge); // set the predecessor of v to u; in this case the edge from u to v
         return true;
     }
     return false;
 }
 
+/**
+ * @brief Relaxation function for a search that runs backwards from the target
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param edge Id of the (forward) edge being relaxed, from its destination to its origin
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Labels of the current search: the cost of every vertex to reach the target,
+ * and the edge it leaves through towards it
+ * @return True if relaxation was successful (shorter path found)
+ *
+ * @details Same checks as relaxdriving/relaxwalking, so a vertex gets the cost of the
+ * best route it would have found with a forward search.
+ */
+template <class T, class Queue>
+bool relaxreverse(const CSRGraph<T> &g, const RouteOverlay &overlay, int edge, bool walking, BasicSearchContext<Queue> &ctx) {
+    int w = walking ? g.getWalkingTime(edge) : g.getDrivingTime(edge);
+    if (w == -1) {return false;} //can't use that edge
+
+    if (overlay.isEdgeAvoided(edge)) {return false;}
+
+    int u = g.getOrig(edge);
+    int v = g.getDest(edge);
+    if (g.getAvailable(v) == -1 || overlay.isNodeAvoided(v)) {return false;}
+
+    if (g.getAvailable(u) == -1 || overlay.isNodeAvoided(u)) {return false;}
+
+    if (ctx.getDist(v) + w < ctx.getDist(u)) {
+        ctx.setDist(u, ctx.getDist(v) + w);
+        ctx.setPath(u, edge);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Marks the vertices a search has to settle before it can stop
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param targets IDs of the vertices, unknown ones are ignored
+ * @param ctx Labels of the current search, already reset: targets get mark 1
+ * @return Number of distinct vertices marked
+ */
+template <class T, class Queue>
+int markTargets(const CSRGraph<T> &g, const std::vector<T> &targets, BasicSearchContext<Queue> &ctx) {
+    int count = 0;
+    for (const T &target : targets) {
+        int t = g.findIdx(target);
+        if (t != -1 && !ctx.getMark(t)) {
+            ctx.setMark(t, 1);
+            count++;
+        }
+    }
+    return count;
+}
+
 /**
  * @brief Dijkstra's algorithm implementation with mode switching
  * @tparam T Type of vertex information
- * @param g Pointer to the graph object
+ * @tparam Queue Priority queue policy of the context
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
  * @param source ID of the source vertex
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Output: distance and edge labels of every vertex index
+ * @param targets IDs of the vertices the caller needs, empty for the whole tree
  *
- * @details Computes shortest paths using:
- * - Driving mode when switchwalking = false
- * - Walking mode when switchwalking = true
- * Uses a priority queue for efficient path calculation
+ * @details Extracts vertices in the same order as the original Vertex based version,
+ * so routes are the same, including among equal cost alternatives.
+ * When targets are given, the search stops once all of them are settled: their
+ * labels and the routes to them are final, the labels of other vertices are not.
  */
+template <class T, class Queue>
+void dijkstra(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, bool walking,
+              BasicSearchContext<Queue> &ctx, const std::vector<T> &targets = {}) {
+    ctx.reset(g.getNumVertex());
+    int s = g.findIdx(source);
+    if (s == -1) return;
+    ctx.setDist(s, 0);
 
-template <class T>
-void dijkstra(Graph<T> * g, const int &source) {
-    // Initialize the vertices
-    for(auto v : g->getVertexSet()) {
-        v->setDist(INF);
-        v->setPath(nullptr);
-    }
-    auto s = g->findVertex(source);
-    s->setDist(0);
+    int remaining = markTargets(g, targets, ctx);
+    if (!targets.empty() && remaining == 0) return;
 
-    MutablePriorityQueue<Vertex<T>> q;
+    Queue &q = ctx.getQueue();
     q.insert(s);
     while( ! q.empty() ) {
-        auto v = q.extractMin();
-        for(auto e : v->getAdj()) {
-            if (!e->getDest()->isVisited()) {
-                auto oldDist = e->getDest()->getDist();
-                if (g->switchwalking) {
-                    if (relaxwalking(e)) {
-                        if (oldDist == INF) {
-                            q.insert(e->getDest());
-                        }
-                        else {
-                            q.decreaseKey(e->getDest());
-                        }
-                    }
-                } else {
-                    if (relaxdriving(e)) {
-                        if (oldDist == INF) {
-                            q.insert(e->getDest());
-                        }
-                        else {
-                            q.decreaseKey(e->getDest());
-                        }
-                    }
+        int v = q.extractMin();
+        if (remaining > 0 && ctx.getMark(v)) {
+            ctx.setMark(v, 0);
+            if (--remaining == 0) return; //every target is settled
+        }
+        for (int e = g.outBegin(v); e < g.outEnd(v); e++) {
+            auto oldDist = ctx.getDist(g.getDest(e));
+            bool relaxed = walking ? relaxwalking(g, overlay, e, ctx) : relaxdriving(g, overlay, e, ctx);
+            if (relaxed) {
+                if (oldDist == INF_DIST) {
+                    q.insert(g.getDest(e));
+                }
+                else {
+                    q.decreaseKey(g.getDest(e));
                 }
             }
         }
     }
 }
 
+/**
+ * @brief Dijkstra's algorithm over the reverse edges of a CSRGraph
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param target ID of the vertex every route ends at
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Output: cost from every vertex index to the target, and the edge it
+ * leaves through towards it
+ * @param sources IDs of the vertices the caller needs, empty for the whole tree
+ *
+ * @details One search gives the cost from every vertex to the target, which would
+ * otherwise need one forward search per vertex. Like dijkstra, it stops once all
+ * the given sources are settled.
+ */
+template <class T, class Queue>
+void dijkstraReverse(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &target, bool walking,
+                     BasicSearchContext<Queue> &ctx, const std::vector<T> &sources = {}) {
+    ctx.reset(g.getNumVertex());
+    int t = g.findIdx(target);
+    if (t == -1) return;
+    ctx.setDist(t, 0);
+
+    int remaining = markTargets(g, sources, ctx);
+    if (!sources.empty() && remaining == 0) return;
+
+    Queue &q = ctx.getQueue();
+    q.insert(t);
+    while( ! q.empty() ) {
+        int v = q.extractMin();
+        if (remaining > 0 && ctx.getMark(v)) {
+            ctx.setMark(v, 0);
+            if (--remaining == 0) return; //every source is settled
+        }
+        for (int e : g.inEdges(v)) {
+            auto oldDist = ctx.getDist(g.getOrig(e));
+            if (relaxreverse(g, overlay, e, walking, ctx)) {
+                if (oldDist == INF_DIST) {
+                    q.insert(g.getOrig(e));
+                }
+                else {
+                    q.decreaseKey(g.getOrig(e));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Dijkstra's algorithm without restrictions
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param source ID of the source vertex
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Output: distance and edge labels of every vertex index
+ */
+template <class T, class Queue>
+void dijkstra(const CSRGraph<T> &g, const int &source, bool walking, BasicSearchContext<Queue> &ctx) {
+    dijkstra(g, RouteOverlay(), source, walking, ctx);
+}
+
+/**
+ * @brief Point-to-point Dijkstra, with per-query restrictions
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param source ID of the source vertex
+ * @param target ID of the only vertex the caller needs
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Output: labels, final for the target and the vertices of its route
+ *
+ * @details Stops as soon as the target is settled, see dijkstra.
+ */
+template <class T, class Queue>
+void dijkstra(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, const int &target, bool walking,
+              BasicSearchContext<Queue> &ctx) {
+    dijkstra(g, overlay, source, walking, ctx, std::vector<T>{target});
+}
+
 /**
  * @brief Reconstructs the shortest path from origin to destination
  * @tparam T Type of vertex information
- * @param g Pointer to the graph object
+ * @param g The graph snapshot
+ * @param ctx Labels filled by dijkstra from origin
  * @param origin ID of the origin vertex
  * @param dest ID of the destination vertex
  * @return Vector containing the sequence of vertex IDs in the path
@@ -139,20 +286,21 @@ void dijkstra(Graph<T> * g, const int &source) {
  * predecessor links, then reverses it to get the correct order.
  * Validates that the path starts at the correct origin.
  */
-template <class T>
-static std::vector<T> getPath(Graph<T> * g, const int &origin, const int &dest) {
+template <class T, class Queue>
+static std::vector<T> getPath(const CSRGraph<T> &g, const BasicSearchContext<Queue> &ctx, const int &origin, const int &dest) {
     std::vector<T> res;
-    auto v = g->findVertex(dest);
-    if (v == nullptr || v->getDist() == INF) { // missing or disconnected
+    int v = g.findIdx(dest);
+    if (v == -1 || ctx.getDist(v) == INF_DIST) { // missing or disconnected
         return res;
     }
-    if (g->findVertex(origin)->getDist() == INF) { // missing or disconnected
+    int o = g.findIdx(origin);
+    if (o == -1 || ctx.getDist(o) == INF_DIST) { // missing or disconnected
         return res;
     }
-    res.push_back(v->getInfo());
-    while(v->getPath() != nullptr) {
-        v = v->getPath()->getOrig();
-        res.push_back(v->getInfo());
+    res.push_back(g.getInfo(v));
+    while (ctx.getPath(v) != -1) {
+        v = g.getOrig(ctx.getPath(v));
+        res.push_back(g.getInfo(v));
     }
     reverse(res.begin(), res.end());
     if(res.empty() || res[0] != origin) {
@@ -164,10 +312,14 @@ static std::vector<T> getPath(Graph<T> * g, const int &origin, const int &dest)
 /**
  * @brief Gets the cost (distance) to reach a destination vertex
  * @tparam T Type of vertex information
- * @param g Pointer to the graph object
+ * @param g The graph snapshot
+ * @param ctx Labels filled by dijkstra
  * @param dest ID of the destination vertex
- * @return The shortest path distance to the destination
+ * @return The shortest path distance to the destination, INF_DIST if it wasn't reached
  */
-template <class T>
-double getCost(Graph<T> * g, const int &dest) {return g->findVertex(dest)->getDist();}
+template <class T, class Queue>
+int getCost(const CSRGraph<T> &g, const BasicSearchContext<Queue> &ctx, const int &dest) {
+    int d = g.findIdx(dest);
+    return d == -1 ? INF_DIST : ctx.getDist(d);
+}
 #endif //DRIVING_H
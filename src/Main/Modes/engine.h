@@ -0,0 +1,201 @@
+/**
+ * @file engine.h
+ * @brief Selection of the algorithm used for point-to-point routes
+ *
+ * @details The driving modes only need the route between two vertices and its cost,
+ * so the algorithm computing it can be chosen at start up (--engine=<name>).
+ * Engines that need preprocessing keep it in a RoutingEngine, built once per graph.
+ * The priority queue of dijkstra is chosen the same way (--queue=<name>).
+ */
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "driving.h"
+#include "bidirectional.h"
+#include "alt.h"
+#include "ch.h"
+#include "allpairs.h"
+
+/**
+ * @brief Algorithms available for point-to-point routes
+ */
+enum class Engine {
+    Dijkstra,       ///< dijkstra stopped at the destination, the reference results
+    Bidirectional,  ///< bidirectionalDijkstra
+    ALT,            ///< altSearch, needs Landmarks
+    CH,             ///< ContractionHierarchy, one per metric
+    AllPairs        ///< AllPairs tables, one lookup per query
+};
+
+/**
+ * @brief Reads an engine name
+ * @param name "dijkstra", "bidirectional", "alt", "ch" or "allpairs"
+ * @param engine Output: the engine with that name
+ * @return false if the name is unknown
+ */
+inline bool parseEngine(const std::string &name, Engine &engine) {
+    if (name == "dijkstra") {
+        engine = Engine::Dijkstra;
+    } else if (name == "bidirectional") {
+        engine = Engine::Bidirectional;
+    } else if (name == "alt") {
+        engine = Engine::ALT;
+    } else if (name == "ch") {
+        engine = Engine::CH;
+    } else if (name == "allpairs") {
+        engine = Engine::AllPairs;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Priority queues available for dijkstra
+ */
+enum class QueuePolicy {
+    Binary,     ///< MutableIndexPriorityQueue, the reference results
+    Quaternary, ///< DaryIndexPriorityQueue<int, 4>
+    Radix,      ///< RadixIndexPriorityQueue
+    Dial        ///< BucketIndexPriorityQueue
+};
+
+/**
+ * @brief Reads a queue policy name
+ * @param name "binary", "4ary", "radix" or "dial"
+ * @param queue Output: the policy with that name
+ * @return false if the name is unknown
+ */
+inline bool parseQueuePolicy(const std::string &name, QueuePolicy &queue) {
+    if (name == "binary") {
+        queue = QueuePolicy::Binary;
+    } else if (name == "4ary") {
+        queue = QueuePolicy::Quaternary;
+    } else if (name == "radix") {
+        queue = QueuePolicy::Radix;
+    } else if (name == "dial") {
+        queue = QueuePolicy::Dial;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Engine chosen for a graph, with the data it precomputed for it
+ * @tparam T Type of vertex information
+ */
+template <class T>
+struct RoutingEngine {
+    Engine type = Engine::Dijkstra;
+    QueuePolicy queue = QueuePolicy::Binary; ///< queue of dijkstra, also when CH falls back to it
+    unsigned landmarkCount = 16; ///< landmarks built by prepare() for ALT
+    Landmarks<T> landmarks;
+    ContractionHierarchy<T> hierarchy[2]; ///< [walking]
+    AllPairsMethod allPairsMethod = AllPairsMethod::Auto; ///< algorithm filling allPairs
+    AllPairs<T> allPairs;
+    bool allPairsLoaded = false; ///< allPairs was read from the folder instead of computed
+
+    /**
+     * @brief Runs the preprocessing the engine needs on a graph
+     * @param g The graph the following queries will use
+     * @param folder Data folder of the graph, where AllPairs tables are saved; empty not to save them
+     */
+    void prepare(const CSRGraph<T> &g, const std::string &folder = "") {
+        if (type == Engine::ALT) landmarks = Landmarks<T>(g, landmarkCount);
+        if (type == Engine::CH) {
+            hierarchy[0] = ContractionHierarchy<T>(g, false);
+            hierarchy[1] = ContractionHierarchy<T>(g, true);
+        }
+        if (type == Engine::AllPairs) {
+            std::string fileName = folder + "/allpairs.bin";
+            allPairsLoaded = !folder.empty() && allPairs.load(fileName, g);
+            if (!allPairsLoaded) {
+                allPairs = AllPairs<T>(g, allPairsMethod, std::max(1u, std::thread::hardware_concurrency()));
+                if (!folder.empty()) allPairs.save(fileName);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Point-to-point dijkstra on the context 0 of the calling thread for a queue policy
+ * @tparam Queue Priority queue of the search
+ * @return Cost of the route, INF_DIST if there is none
+ */
+template <class Queue, class T>
+int dijkstraRoute(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, const int &dest,
+                  bool walking, std::vector<T> &route) {
+    BasicSearchContext<Queue> &ctx = threadContext<Queue>(0);
+    dijkstra(g, overlay, source, dest, walking, ctx);
+    route = getPath(g, ctx, source, dest);
+    return getCost(g, ctx, dest);
+}
+
+/**
+ * @brief Point-to-point dijkstra with the queue policy of an engine
+ * @return Cost of the route, INF_DIST if there is none
+ */
+template <class T>
+int dijkstraRoute(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, const int &dest,
+                  bool walking, std::vector<T> &route, QueuePolicy queue) {
+    switch (queue) {
+        case QueuePolicy::Quaternary:
+            return dijkstraRoute<DaryIndexPriorityQueue<int, 4>>(g, overlay, source, dest, walking, route);
+        case QueuePolicy::Radix:
+            return dijkstraRoute<RadixIndexPriorityQueue<int>>(g, overlay, source, dest, walking, route);
+        case QueuePolicy::Dial:
+            return dijkstraRoute<BucketIndexPriorityQueue<int>>(g, overlay, source, dest, walking, route);
+        case QueuePolicy::Binary:
+        default:
+            return dijkstraRoute<MutableIndexPriorityQueue<int>>(g, overlay, source, dest, walking, route);
+    }
+}
+
+/**
+ * @brief Computes the route between two vertices with the chosen engine
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the current query
+ * @param source ID of the source vertex
+ * @param dest ID of the destination vertex
+ * @param walking false to use driving times, true to use walking times
+ * @param route Output: IDs of the vertices of the route, empty if there is none
+ * @param engine Algorithm to use, prepared for g
+ * @return Cost of the route, INF_DIST if there is none
+ *
+ * @details Searches use the contexts 0 and 1 of the calling thread (threadContext).
+ * A hierarchy or all-pairs tables can't honor avoided vertices or segments, so
+ * CH and AllPairs queries with any of them are answered by dijkstra. ALT gives
+ * dijkstra's route, and asks dijkstra when tied predecessors make it ambiguous.
+ */
+template <class T>
+int shortestRoute(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, const int &dest,
+                  bool walking, std::vector<T> &route, const RoutingEngine<T> &engine) {
+    SearchContext &ctx = threadContext(0);
+    switch (engine.type) {
+        case Engine::Bidirectional:
+            return bidirectionalDijkstra(g, overlay, source, dest, walking, route, ctx, threadContext(1));
+        case Engine::ALT:
+            if (altSearch(g, overlay, engine.landmarks, source, dest, walking, ctx)) break;
+            return dijkstraRoute(g, overlay, source, dest, walking, route, engine.queue); // tied predecessors
+        case Engine::CH:
+            if (overlay.empty()) return engine.hierarchy[walking].query(g, source, dest, route);
+            return dijkstraRoute(g, overlay, source, dest, walking, route, engine.queue);
+        case Engine::AllPairs:
+            if (overlay.empty()) return engine.allPairs.query(g, source, dest, walking, route);
+            return dijkstraRoute(g, overlay, source, dest, walking, route, engine.queue);
+        case Engine::Dijkstra:
+        default:
+            return dijkstraRoute(g, overlay, source, dest, walking, route, engine.queue);
+    }
+    route = getPath(g, ctx, source, dest);
+    return getCost(g, ctx, dest);
+}
+
+#endif //ENGINE_H
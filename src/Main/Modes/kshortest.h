@@ -0,0 +1,212 @@
+/**
+ * @file kshortest.h
+ * @brief k shortest loopless routes between two vertices (Yen's algorithm)
+ *
+ * @details Each new route deviates from one already found at some "spur" vertex:
+ * the part before it is kept, and the rest is the best route from the spur vertex
+ * that avoids the vertices before it and the edges the known routes take there.
+ * All the spur searches end at the same destination, so one reverse search from it
+ * is done up front and reused by all of them:
+ * - if the tree route from the spur vertex is not blocked, it is the answer as is;
+ * - otherwise the spur search is an A* guided by the tree distances, which are
+ *   exact lower bounds once vertices and edges are blocked.
+ */
+
+#ifndef KSHORTEST_H
+#define KSHORTEST_H
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include "driving.h"
+
+/**
+ * @brief Route between two vertices, with its cost
+ * @tparam T Type of vertex information
+ */
+template <class T>
+struct Route {
+    std::vector<T> vertices; ///< IDs, from the source to the destination
+    int cost = INF_DIST;
+};
+
+/**
+ * @brief Route as edge ids of a CSRGraph, used while searching
+ */
+struct EdgeRoute {
+    std::vector<int> edges;
+    int cost = 0;
+
+    bool operator<(const EdgeRoute &other) const {
+        return cost != other.cost ? cost < other.cost : edges < other.edges;
+    }
+};
+
+/**
+ * @brief Best route from a vertex to the root of a reverse tree, avoiding an overlay
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the query plus the vertices and edges blocked for this spur
+ * @param tree Labels of dijkstraReverse to the destination, under the restrictions of the query
+ * @param from Vertex index of the spur vertex
+ * @param t Vertex index of the destination
+ * @param walking false to use driving times, true to use walking times
+ * @param ctx Labels of the search
+ * @param route Output: edges of the route, empty if there is none
+ * @return Cost of the route, INF_DIST if there is none
+ */
+template <class T>
+int spurSearch(const CSRGraph<T> &g, const RouteOverlay &overlay, const SearchContext &tree, int from, int t,
+               bool walking, SearchContext &ctx, std::vector<int> &route) {
+    route.clear();
+    if (tree.getDist(from) == INF_DIST) return INF_DIST;
+
+    // the tree route, when nothing on it is blocked
+    bool blocked = false;
+    for (int v = from; v != t && !blocked; v = g.getDest(tree.getPath(v))) {
+        int e = tree.getPath(v);
+        blocked = overlay.isEdgeAvoided(e) || overlay.isNodeAvoided(g.getDest(e));
+        route.push_back(e);
+    }
+    if (!blocked) return tree.getDist(from);
+    route.clear();
+
+    ctx.reset(g.getNumVertex());
+    ctx.setDist(from, 0);
+    ctx.setKey(from, tree.getDist(from));
+    MutableIndexPriorityQueue<int> &q = ctx.getQueue();
+    q.insert(from);
+    while( ! q.empty() ) {
+        int v = q.extractMin();
+        if (v == t) break;
+        for (int e = g.outBegin(v); e < g.outEnd(v); e++) {
+            int w = g.getDest(e);
+            if (tree.getDist(w) == INF_DIST) continue; // the destination can't be reached from w
+            auto oldDist = ctx.getDist(w);
+            bool relaxed = walking ? relaxwalking(g, overlay, e, ctx) : relaxdriving(g, overlay, e, ctx);
+            if (relaxed) {
+                ctx.setKey(w, ctx.getDist(w) + tree.getDist(w));
+                if (oldDist == INF_DIST) {
+                    q.insert(w);
+                }
+                else {
+                    q.decreaseKey(w);
+                }
+            }
+        }
+    }
+    if (ctx.getDist(t) == INF_DIST) return INF_DIST;
+    for (int v = t; v != from; v = g.getOrig(ctx.getPath(v))) {
+        route.push_back(ctx.getPath(v));
+    }
+    reverse(route.begin(), route.end());
+    return ctx.getDist(t);
+}
+
+/**
+ * @brief Finds up to k loopless routes between two vertices, by increasing cost
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the query
+ * @param first Best route, e.g. from shortestRoute (IDs, source to destination)
+ * @param k Number of routes wanted, first included
+ * @param walking false to use driving times, true to use walking times
+ * @param tree Labels of the reverse search, kept for all the spur searches
+ * @param ctx Labels of the spur searches
+ * @return The routes, first one first; fewer than k if there aren't that many
+ *
+ * @details Two routes through the same vertices but different parallel edges
+ * count as different routes.
+ */
+template <class T>
+std::vector<Route<T>> kShortestRoutes(const CSRGraph<T> &g, const RouteOverlay &overlay, const std::vector<T> &first,
+                                      unsigned k, bool walking, SearchContext &tree, SearchContext &ctx) {
+    std::vector<Route<T>> res;
+    if (first.empty() || k == 0) return res;
+    int s = g.findIdx(first.front());
+    int t = g.findIdx(first.back());
+    if (s == -1 || t == -1) return res;
+    auto weight = [&](int e) { return walking ? g.getWalkingTime(e) : g.getDrivingTime(e); };
+
+    // the best route as edges, taking the cheapest edge between consecutive vertices
+    EdgeRoute best;
+    for (size_t i = 0; i + 1 < first.size(); i++) {
+        int u = g.findIdx(first[i]);
+        int v = g.findIdx(first[i + 1]);
+        int chosen = -1;
+        for (int e = g.outBegin(u); e < g.outEnd(u); e++) {
+            if (g.getDest(e) != v || weight(e) == -1 || overlay.isEdgeAvoided(e)) continue;
+            if (chosen == -1 || weight(e) < weight(chosen)) chosen = e;
+        }
+        if (chosen == -1) return res;
+        best.edges.push_back(chosen);
+        best.cost += weight(chosen);
+    }
+
+    dijkstraReverse(g, overlay, first.back(), walking, tree);
+
+    std::vector<EdgeRoute> found = {best};
+    std::set<std::vector<int>> foundEdges = {best.edges}; // to skip candidates already found in O(log k)
+    std::set<EdgeRoute> candidates;
+    RouteOverlay spur = overlay;
+    std::vector<int> blockedNodes, blockedEdges, spurRoute;
+    while (found.size() < k) {
+        const EdgeRoute &last = found.back();
+        int rootCost = 0;
+        for (size_t i = 0; i <= last.edges.size(); i++) {
+            int spurNode = i == 0 ? s : g.getDest(last.edges[i - 1]);
+            if (spurNode == t) break;
+
+            // edges leaving the spur vertex along the routes that share this root
+            for (const EdgeRoute &r : found) {
+                if (r.edges.size() > i && std::equal(last.edges.begin(), last.edges.begin() + i, r.edges.begin())
+                    && !spur.isEdgeAvoided(r.edges[i])) {
+                    spur.avoidEdge(r.edges[i]);
+                    blockedEdges.push_back(r.edges[i]);
+                }
+            }
+            // vertices of the root, so that the route stays loopless
+            for (size_t j = 0; j < i; j++) {
+                int v = g.getOrig(last.edges[j]);
+                spur.avoidNode(v);
+                blockedNodes.push_back(v);
+            }
+
+            int cost = spurSearch(g, spur, tree, spurNode, t, walking, ctx, spurRoute);
+            if (cost != INF_DIST) {
+                EdgeRoute candidate;
+                candidate.edges.assign(last.edges.begin(), last.edges.begin() + i);
+                candidate.edges.insert(candidate.edges.end(), spurRoute.begin(), spurRoute.end());
+                candidate.cost = rootCost + cost;
+                candidates.insert(candidate);
+            }
+
+            for (int v : blockedNodes) spur.allowNode(v);
+            for (int e : blockedEdges) spur.allowEdge(e);
+            blockedNodes.clear();
+            blockedEdges.clear();
+            if (i < last.edges.size()) rootCost += weight(last.edges[i]);
+        }
+
+        // the cheapest candidate that isn't a route already found
+        while (!candidates.empty() && foundEdges.count(candidates.begin()->edges)) {
+            candidates.erase(candidates.begin());
+        }
+        if (candidates.empty()) break;
+        found.push_back(*candidates.begin());
+        foundEdges.insert(found.back().edges);
+        candidates.erase(candidates.begin());
+    }
+
+    for (const EdgeRoute &r : found) {
+        Route<T> route;
+        route.cost = r.cost;
+        route.vertices.push_back(g.getInfo(s));
+        for (int e : r.edges) route.vertices.push_back(g.getInfo(g.getDest(e)));
+        res.push_back(std::move(route));
+    }
+    return res;
+}
+
+#endif //KSHORTEST_H
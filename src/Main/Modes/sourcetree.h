@@ -0,0 +1,65 @@
+/**
+ * @file sourcetree.h
+ * @brief Shortest path tree from one source, shared by the queries that start there
+ *
+ * @details Batch mode groups the blocks with the same source and restrictions.
+ * One full driving dijkstra from that source answers all of them: once a vertex
+ * is settled its label and route never change, so the tree holds the same route
+ * to every destination as a search stopped there, and the same driving times to
+ * every parking node as the one-to-many search of the driving-walking mode.
+ */
+
+#ifndef SOURCETREE_H
+#define SOURCETREE_H
+
+#include "driving.h"
+
+/**
+ * @class SourceTree
+ * @brief Driving labels from one source under one set of restrictions, searched when first needed
+ * @tparam T Type of vertex information
+ *
+ * @details Queries answered from the cache don't need the tree, so it is only
+ * built by the first get(). Labels are kept in context 3 of the calling thread
+ * (threadContext), which the modes don't use, so the tree and everything built
+ * from it must stay on that thread.
+ */
+template <class T>
+class SourceTree {
+public:
+    /**
+     * @param g The graph snapshot
+     * @param overlay Restrictions shared by the queries, without required vertices
+     * @param source ID of the source shared by the queries
+     */
+    SourceTree(const CSRGraph<T> &g, const RouteOverlay &overlay, const T &source)
+        : g(g), overlay(overlay), source(source) {}
+
+    /**
+     * @brief Gets the labels of the tree, searching it on the first call
+     * @return Driving distance and edge labels of every vertex index
+     */
+    const SearchContext &get();
+
+    /**
+     * @brief Gets the source of the tree
+     */
+    const T &getSource() const { return source; }
+
+protected:
+    const CSRGraph<T> &g;
+    const RouteOverlay &overlay;
+    T source;
+    SearchContext *ctx = nullptr;
+};
+
+template <class T>
+const SearchContext &SourceTree<T>::get() {
+    if (ctx == nullptr) {
+        ctx = &threadContext(3);
+        dijkstra(g, overlay, source, false, *ctx);
+    }
+    return *ctx;
+}
+
+#endif //SOURCETREE_H
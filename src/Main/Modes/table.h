@@ -0,0 +1,116 @@
+/**
+ * @file table.h
+ * @brief Many-to-many tables of driving or walking times
+ *
+ * @details A table is the cost from every source to every target, e.g. for fleet
+ * assignment. It is computed with much less work than one full search per pair:
+ * - with a contraction hierarchy and no restrictions, by its bucket based table
+ *   (ContractionHierarchy::table), a few dozen settled vertices per source and target;
+ * - with all-pairs tables and no restrictions, by looking every pair up;
+ * - otherwise with one one-to-many dijkstra per source that stops once every target
+ *   is settled, or one dijkstraReverse per target if there are fewer targets.
+ * Rows (or columns) are spread over threads, each with its own SearchContext.
+ */
+
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "engine.h"
+#include "../data_structures/ParallelFor.h"
+
+/**
+ * @brief Costs between a list of sources and a list of targets
+ * @tparam T Type of vertex information
+ */
+template <class T>
+struct DistanceTable {
+    std::vector<T> sources;  ///< IDs of the rows
+    std::vector<T> targets;  ///< IDs of the columns
+    std::vector<int> times;  ///< times[i * targets.size() + j], INF_DIST if there is no route
+
+    /**
+     * @brief Gets the cost from sources[i] to targets[j]
+     */
+    int at(size_t i, size_t j) const {
+        return times[i * targets.size() + j];
+    }
+};
+
+/**
+ * @brief Fills a table with one-to-many dijkstra searches
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the query
+ * @param walking false to use driving times, true to use walking times
+ * @param threads Maximum number of threads
+ * @param table Sources and targets already set; times is filled
+ *
+ * @details Searches from the smaller side: forward from every source, or backwards
+ * from every target with dijkstraReverse. Each one stops once the other side is settled.
+ */
+template <class T>
+void dijkstraTable(const CSRGraph<T> &g, const RouteOverlay &overlay, bool walking, unsigned threads,
+                   DistanceTable<T> &table) {
+    size_t cols = table.targets.size();
+    table.times.assign(table.sources.size() * cols, INF_DIST);
+    if (table.sources.size() <= cols) {
+        parallelFor(table.sources.size(), threads, [&](size_t i) {
+            SearchContext &ctx = threadContext(0);
+            dijkstra(g, overlay, table.sources[i], walking, ctx, table.targets);
+            for (size_t j = 0; j < cols; j++) table.times[i * cols + j] = getCost(g, ctx, table.targets[j]);
+        });
+    } else {
+        parallelFor(cols, threads, [&](size_t j) {
+            SearchContext &ctx = threadContext(0);
+            dijkstraReverse(g, overlay, table.targets[j], walking, ctx, table.sources);
+            for (size_t i = 0; i < table.sources.size(); i++) table.times[i * cols + j] = getCost(g, ctx, table.sources[i]);
+        });
+    }
+}
+
+/**
+ * @brief Computes the cost from every source to every target
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the query (AvoidNodes, AvoidSegments)
+ * @param sources IDs of the sources, unknown ones get a row of INF_DIST
+ * @param targets IDs of the targets, unknown ones get a column of INF_DIST
+ * @param walking false to use driving times, true to use walking times
+ * @param engine Prepared engine: its hierarchy or all-pairs tables are used when it has them and
+ * there are no restrictions
+ * @param threads Maximum number of threads
+ * @return The table
+ */
+template <class T>
+DistanceTable<T> distanceTable(const CSRGraph<T> &g, const RouteOverlay &overlay, const std::vector<T> &sources,
+                               const std::vector<T> &targets, bool walking, const RoutingEngine<T> &engine,
+                               unsigned threads) {
+    DistanceTable<T> table;
+    table.sources = sources;
+    table.targets = targets;
+    const ContractionHierarchy<T> &hierarchy = engine.hierarchy[walking];
+    if (engine.type == Engine::CH && overlay.empty() && !hierarchy.empty()) {
+        std::vector<int> s, t;
+        for (const T &id : sources) s.push_back(g.findIdx(id));
+        for (const T &id : targets) t.push_back(g.findIdx(id));
+        auto rowSearch = [threads](size_t count, auto fn) { parallelFor(count, threads, fn); };
+        hierarchy.table(g, s, t, rowSearch, table.times);
+    } else if (engine.type == Engine::AllPairs && overlay.empty() && !engine.allPairs.empty()) {
+        table.times.assign(sources.size() * targets.size(), INF_DIST);
+        for (size_t i = 0; i < sources.size(); i++) {
+            int s = g.findIdx(sources[i]);
+            for (size_t j = 0; j < targets.size() && s != -1; j++) {
+                int t = g.findIdx(targets[j]);
+                if (t != -1) table.times[i * targets.size() + j] = engine.allPairs.getDist(s, t, walking);
+            }
+        }
+    } else {
+        dijkstraTable(g, overlay, walking, threads, table);
+    }
+    return table;
+}
+
+#endif //TABLE_H
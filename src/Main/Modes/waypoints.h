@@ -0,0 +1,232 @@
+/**
+ * @file waypoints.h
+ * @brief Driving route through several required vertices, in the best order
+ *
+ * @details The cost of every leg is found with one one-to-many search per stop
+ * (the source and each waypoint), which stops once all the other stops are settled,
+ * instead of one full search per pair. The visiting order is then chosen on the
+ * small table of leg costs:
+ * - up to exactWaypointLimit waypoints, exactly, by dynamic programming over the
+ *   subsets of waypoints already visited (Held-Karp);
+ * - beyond that, by nearest neighbour followed by moving single waypoints and
+ *   reversing stretches of the order (2-opt) while the total cost improves.
+ * Leg costs need not be symmetric: every candidate order is evaluated as a whole.
+ */
+
+#ifndef WAYPOINTS_H
+#define WAYPOINTS_H
+
+#include <algorithm>
+#include <vector>
+
+#include "driving.h"
+
+/**
+ * @brief Largest number of waypoints whose order is chosen exactly
+ */
+const size_t exactWaypointLimit = 15;
+
+/**
+ * @brief Costs and routes of the legs between the stops of a waypoint query
+ * @tparam T Type of vertex information
+ *
+ * @details Stop 0 is the source, stops 1..k the waypoints and stop k+1 the destination.
+ */
+template <class T>
+struct WaypointLegs {
+    std::vector<std::vector<long long>> cost;       ///< cost[i][j], INF_DIST if there is no route
+    std::vector<std::vector<std::vector<T>>> route; ///< route[i][j], IDs from stop i to stop j
+};
+
+/**
+ * @brief Total cost of visiting the waypoints in a given order
+ * @tparam T Type of vertex information
+ * @param legs Leg costs
+ * @param order Waypoints, as stop numbers
+ * @return Cost from the source to the destination, INF_DIST if a leg has no route
+ */
+template <class T>
+long long orderCost(const WaypointLegs<T> &legs, const std::vector<int> &order) {
+    int last = 0;
+    long long total = 0;
+    for (size_t i = 0; i <= order.size(); i++) {
+        int next = i < order.size() ? order[i] : (int) legs.cost.size() - 1;
+        if (legs.cost[last][next] == INF_DIST) return INF_DIST;
+        total += legs.cost[last][next];
+        last = next;
+    }
+    return total;
+}
+
+/**
+ * @brief Best order of the waypoints, by dynamic programming over subsets
+ * @tparam T Type of vertex information
+ * @param legs Leg costs
+ * @return Waypoints as stop numbers, empty if no order has a route
+ *
+ * @details O(2^k k^2) time and O(2^k k) memory for k waypoints.
+ */
+template <class T>
+std::vector<int> exactWaypointOrder(const WaypointLegs<T> &legs) {
+    int k = (int) legs.cost.size() - 2;
+    int dest = k + 1;
+    if (k == 0) return {};
+    size_t full = ((size_t) 1 << k) - 1;
+    // best[mask*k + i]: cheapest route from the source through the waypoints of mask, ending at waypoint i+1
+    std::vector<long long> best((full + 1) * k, INF_DIST);
+    std::vector<signed char> prev((full + 1) * k, -1);
+    for (int i = 0; i < k; i++) best[((size_t) 1 << i) * k + i] = legs.cost[0][i + 1];
+
+    for (size_t mask = 1; mask <= full; mask++) {
+        for (int i = 0; i < k; i++) {
+            if (!(mask >> i & 1) || best[mask * k + i] == INF_DIST) continue;
+            for (int j = 0; j < k; j++) {
+                if (mask >> j & 1 || legs.cost[i + 1][j + 1] == INF_DIST) continue;
+                size_t next = (mask | (size_t) 1 << j) * k + j;
+                long long cost = best[mask * k + i] + legs.cost[i + 1][j + 1];
+                if (cost < best[next]) {
+                    best[next] = cost;
+                    prev[next] = (signed char) i;
+                }
+            }
+        }
+    }
+
+    int last = -1;
+    long long bestCost = INF_DIST;
+    for (int i = 0; i < k; i++) {
+        if (best[full * k + i] == INF_DIST || legs.cost[i + 1][dest] == INF_DIST) continue;
+        if (best[full * k + i] + legs.cost[i + 1][dest] < bestCost) {
+            bestCost = best[full * k + i] + legs.cost[i + 1][dest];
+            last = i;
+        }
+    }
+    std::vector<int> order;
+    if (last == -1) return order;
+    for (size_t mask = full; last != -1; ) {
+        order.push_back(last + 1);
+        int before = prev[mask * k + last];
+        mask &= ~((size_t) 1 << last);
+        last = before;
+    }
+    reverse(order.begin(), order.end());
+    return order;
+}
+
+/**
+ * @brief Good order of the waypoints, by nearest neighbour and local improvement
+ * @tparam T Type of vertex information
+ * @param legs Leg costs
+ * @return Waypoints as stop numbers, possibly with no route if none was found
+ */
+template <class T>
+std::vector<int> heuristicWaypointOrder(const WaypointLegs<T> &legs) {
+    int k = (int) legs.cost.size() - 2;
+    std::vector<int> order;
+    std::vector<bool> visited(k + 1, false);
+    for (int last = 0; (int) order.size() < k; ) {
+        int next = -1;
+        for (int j = 1; j <= k; j++) {
+            if (visited[j]) continue;
+            if (next == -1 || legs.cost[last][j] < legs.cost[last][next]) next = j;
+        }
+        visited[next] = true;
+        order.push_back(next);
+        last = next;
+    }
+
+    long long cost = orderCost(legs, order);
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        // 2-opt: reverse order[i..j]
+        for (int i = 0; i < k; i++) {
+            for (int j = i + 1; j < k; j++) {
+                reverse(order.begin() + i, order.begin() + j + 1);
+                long long c = orderCost(legs, order);
+                if (c < cost) {
+                    cost = c;
+                    improved = true;
+                } else {
+                    reverse(order.begin() + i, order.begin() + j + 1);
+                }
+            }
+        }
+        // relocation: move order[i] to position j
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < k; j++) {
+                if (i == j) continue;
+                std::vector<int> moved = order;
+                int w = moved[i];
+                moved.erase(moved.begin() + i);
+                moved.insert(moved.begin() + j, w);
+                long long c = orderCost(legs, moved);
+                if (c < cost) {
+                    cost = c;
+                    order.swap(moved);
+                    improved = true;
+                }
+            }
+        }
+    }
+    return order;
+}
+
+/**
+ * @brief Finds the cheapest driving route that passes through every waypoint
+ * @tparam T Type of vertex information
+ * @param g The graph snapshot
+ * @param overlay Restrictions of the query, with the waypoints in includeNodes
+ * @param source ID of the source vertex
+ * @param dest ID of the destination vertex
+ * @param ctx Labels of the leg searches
+ * @param route Output: IDs of the route, empty if there is none
+ * @return Cost of the route, INF_DIST if there is none
+ *
+ * @details Legs are routed independently, so the route may go through a vertex
+ * more than once. With a single waypoint this is the old IncludeNode behaviour:
+ * the best route to it followed by the best route from it.
+ */
+template <class T>
+int waypointRoute(const CSRGraph<T> &g, const RouteOverlay &overlay, const int &source, const int &dest,
+                  SearchContext &ctx, std::vector<T> &route) {
+    route.clear();
+    std::vector<int> waypoints = overlay.includeNodes;
+    std::sort(waypoints.begin(), waypoints.end()); // same route whatever order they were given in
+    std::vector<T> stops = {source};
+    for (int v : waypoints) stops.push_back(g.getInfo(v));
+    stops.push_back(dest);
+    size_t n = stops.size();
+
+    WaypointLegs<T> legs;
+    legs.cost.assign(n, std::vector<long long>(n, INF_DIST));
+    legs.route.assign(n, std::vector<std::vector<T>>(n));
+    for (size_t i = 0; i + 1 < n; i++) {
+        std::vector<T> targets;
+        for (size_t j = 1; j < n; j++) {
+            if (j != i) targets.push_back(stops[j]);
+        }
+        dijkstra(g, overlay, stops[i], false, ctx, targets);
+        for (size_t j = 1; j < n; j++) {
+            if (j == i) continue;
+            int cost = getCost(g, ctx, stops[j]);
+            if (cost == INF_DIST) continue;
+            legs.cost[i][j] = cost;
+            legs.route[i][j] = getPath(g, ctx, stops[i], stops[j]);
+        }
+    }
+
+    std::vector<int> order = n - 2 <= exactWaypointLimit ? exactWaypointOrder(legs) : heuristicWaypointOrder(legs);
+    long long total = order.size() == n - 2 ? orderCost(legs, order) : INF_DIST;
+    if (total >= INF_DIST) return INF_DIST;
+
+    order.push_back(n - 1);
+    route.push_back(source);
+    for (size_t i = 0, last = 0; i < order.size(); last = order[i++]) {
+        const std::vector<T> &leg = legs.route[last][order[i]];
+        route.insert(route.end(), leg.begin() + 1, leg.end());
+    }
+    return (int) total;
+}
+
+#endif //WAYPOINTS_H
@@ -0,0 +1,295 @@
+/**
+* @file BlockServer.cpp
+ * @brief Implementation of the resident block server
+ */
+
+#include <iostream>
+#include <map>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define BLOCK_SERVER_SOCKETS 1
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#include "./BlockServer.h"
+
+/**
+ * @brief State of one client connection, only touched by the thread running run()
+ */
+struct BlockServer::Connection {
+    int fd = -1;
+    std::string input;                          // received, not yet split in lines
+    std::vector<std::string> block;             // lines of the block being received
+    std::size_t received = 0;                   // blocks submitted
+    std::size_t answered = 0;                   // answers moved to output, in order
+    std::map<std::size_t, std::string> done;    // answers waiting for earlier ones
+    std::string output;                         // answers not yet sent
+    bool eof = false;                           // the client shut down its side
+    bool broken = false;                        // error, close without sending the rest
+};
+
+BlockServer::BlockServer(unsigned threads, Solve solve)
+    : threads(threads ? threads : 1), solve(std::move(solve)), tasks(4096) {}
+
+BlockServer::~BlockServer() {
+#ifdef BLOCK_SERVER_SOCKETS
+    if (listenFd != -1) ::close(listenFd);
+    if (wake[0] != -1) ::close(wake[0]);
+    if (wake[1] != -1) ::close(wake[1]);
+    if (!unixPath.empty()) ::unlink(unixPath.c_str());
+#endif
+}
+
+#ifdef BLOCK_SERVER_SOCKETS
+
+/**
+ * @brief Makes a descriptor non blocking
+ */
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+/**
+ * @brief Prints the last system error
+ */
+static bool socketError(const std::string &what) {
+    std::cerr << "Error: " << what << ": " << std::strerror(errno) << std::endl;
+    return false;
+}
+
+bool BlockServer::listenUnix(const std::string &path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: Socket path too long " << path << std::endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd == -1) return socketError("socket");
+    ::unlink(path.c_str()); // left behind by a server that was killed
+    if (bind(listenFd, (sockaddr *) &addr, sizeof(addr)) == -1) return socketError("bind " + path);
+    unixPath = path;
+    if (listen(listenFd, SOMAXCONN) == -1 || !setNonBlocking(listenFd)) return socketError("listen " + path);
+    return true;
+}
+
+bool BlockServer::listenTcp(int port) {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd == -1) return socketError("socket");
+    int yes = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listenFd, (sockaddr *) &addr, sizeof(addr)) == -1) return socketError("bind port " + std::to_string(port));
+    if (listen(listenFd, SOMAXCONN) == -1 || !setNonBlocking(listenFd)) return socketError("listen");
+    socklen_t length = sizeof(addr);
+    getsockname(listenFd, (sockaddr *) &addr, &length);
+    this->port = ntohs(addr.sin_port);
+    return true;
+}
+
+int BlockServer::getPort() const {
+    return port;
+}
+
+void BlockServer::stop() {
+    stopping = true;
+    char c = 0;
+    if (wake[1] != -1) (void) !::write(wake[1], &c, 1);
+}
+
+/**
+ * @brief Queues the block being received for the workers
+ */
+void BlockServer::submit(uint64_t id, Connection &c) {
+    tasks.push({id, c.received++, std::move(c.block)});
+    c.block.clear();
+}
+
+/**
+ * @brief Reads what a connection sent and submits the blocks it completes
+ * @return false if the connection failed
+ */
+bool BlockServer::receive(uint64_t id, Connection &c) {
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            c.input.append(buffer, n);
+            continue;
+        }
+        if (n == 0) {
+            c.eof = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    std::size_t start = 0;
+    for (std::size_t end; (end = c.input.find('\n', start)) != std::string::npos; start = end + 1) {
+        std::string line = c.input.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find("Mode:") == 0 && !c.block.empty()) submit(id, c);
+        if (line.empty()) {
+            if (!c.block.empty()) submit(id, c);
+        } else {
+            c.block.push_back(line);
+        }
+    }
+    c.input.erase(0, start);
+    if (c.eof) {
+        if (!c.input.empty()) c.block.push_back(c.input);
+        c.input.clear();
+        if (!c.block.empty()) submit(id, c);
+    }
+    return true;
+}
+
+void BlockServer::run() {
+    if (listenFd == -1) return;
+    if (pipe(wake) == -1 || !setNonBlocking(wake[0]) || !setNonBlocking(wake[1])) {
+        socketError("pipe");
+        return;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back([this]() {
+            Task task;
+            while (tasks.pop(task)) {
+                std::string text = solve(task.block);
+                {
+                    std::lock_guard<std::mutex> lock(resultMutex);
+                    results.push_back({task.connection, task.seq, std::move(text)});
+                }
+                char c = 0;
+                (void) !::write(wake[1], &c, 1);
+            }
+        });
+    }
+
+    std::map<uint64_t, Connection> connections;
+    uint64_t nextId = 0;
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> ids;
+    std::vector<Result> finished;
+    while (!stopping) {
+        fds.assign({{wake[0], POLLIN, 0}, {listenFd, POLLIN, 0}});
+        ids.clear();
+        for (auto &[id, c] : connections) {
+            short events = 0;
+            if (!c.eof && c.received - c.answered < maxPending) events |= POLLIN;
+            if (!c.output.empty()) events |= POLLOUT;
+            fds.push_back({events ? c.fd : -1, events, 0}); // poll() skips negative descriptors
+            ids.push_back(id);
+        }
+        if (poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR) continue;
+            socketError("poll");
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char drain[256];
+            while (::read(wake[0], drain, sizeof(drain)) > 0) {}
+            {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                finished.swap(results);
+            }
+            for (Result &result : finished) {
+                auto it = connections.find(result.connection);
+                if (it == connections.end()) continue; // the client is gone
+                Connection &c = it->second;
+                c.done.emplace(result.seq, std::move(result.text));
+                for (auto d = c.done.begin(); d != c.done.end() && d->first == c.answered; d = c.done.erase(d)) {
+                    c.output += d->second;
+                    c.answered++;
+                }
+            }
+            finished.clear();
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listenFd, nullptr, nullptr)) != -1) {
+                if (!setNonBlocking(fd)) {
+                    ::close(fd);
+                    continue;
+                }
+                connections[nextId++].fd = fd;
+            }
+        }
+
+        for (std::size_t i = 0; i < ids.size(); i++) {
+            Connection &c = connections[ids[i]];
+            short revents = fds[i + 2].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (!c.eof && !receive(ids[i], c)) c.broken = true;
+            }
+            while (!c.broken && !c.output.empty()) {
+                ssize_t n = send(c.fd, c.output.data(), c.output.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    c.output.erase(0, n);
+                } else if (n == -1 && errno == EINTR) {
+                    continue;
+                } else {
+                    if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK) c.broken = true;
+                    break;
+                }
+            }
+            if (c.broken || (c.eof && c.answered == c.received && c.output.empty())) {
+                ::close(c.fd);
+                connections.erase(ids[i]);
+            }
+        }
+    }
+
+    tasks.close();
+    for (std::thread &t : pool) t.join();
+    for (auto &[id, c] : connections) ::close(c.fd);
+}
+
+#else
+
+bool BlockServer::listenUnix(const std::string &path) {
+    std::cerr << "Error: Server mode needs POSIX sockets" << std::endl;
+    return false;
+}
+
+bool BlockServer::listenTcp(int port) {
+    std::cerr << "Error: Server mode needs POSIX sockets" << std::endl;
+    return false;
+}
+
+int BlockServer::getPort() const {
+    return port;
+}
+
+void BlockServer::run() {}
+
+void BlockServer::stop() {
+    stopping = true;
+}
+
+#endif
@@ -0,0 +1,112 @@
+/**
+* @file BlockServer.h
+ * @brief Resident server answering batch mode blocks over a local socket
+ *
+ * @details Clients send blocks in the format of input.txt and get back the text batch
+ * mode would write to output.txt, in the order of their blocks. A block ends at the
+ * next "Mode:" line, at an empty line, or when the client shuts down its side of the
+ * connection, so a client can send one block, wait for its answer and send the next
+ * one on the same connection. One thread multiplexes every connection with poll();
+ * the blocks are answered by a pool of workers.
+ */
+
+#ifndef SRC_BLOCK_SERVER_H
+#define SRC_BLOCK_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Pipeline.h"
+
+/**
+ * @class BlockServer
+ * @brief Listens on a Unix domain socket or a localhost TCP port and answers blocks
+ *
+ * @details Only available on POSIX systems; elsewhere listening fails.
+ */
+class BlockServer {
+public:
+    /**
+     * @brief Answers one block: its lines, the "Mode:" line first
+     */
+    using Solve = std::function<std::string(const std::vector<std::string> &)>;
+
+    /**
+     * @param threads Number of workers answering blocks, at least 1 is used
+     * @param solve Answers a block, must be thread safe
+     */
+    BlockServer(unsigned threads, Solve solve);
+    ~BlockServer();
+    BlockServer(const BlockServer &) = delete;
+    BlockServer &operator=(const BlockServer &) = delete;
+
+    /**
+     * @brief Listens on a Unix domain socket, replacing a stale socket file at that path
+     * @param path Path of the socket, removed by the destructor
+     * @return false on error, which is printed
+     */
+    bool listenUnix(const std::string &path);
+
+    /**
+     * @brief Listens on a TCP port of 127.0.0.1
+     * @param port Port number, 0 for any free one (see getPort)
+     * @return false on error, which is printed
+     */
+    bool listenTcp(int port);
+
+    /**
+     * @brief Gets the TCP port listened on, -1 if not listening on TCP
+     */
+    int getPort() const;
+
+    /**
+     * @brief Serves connections until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief Makes run() return; connections still open are closed
+     * @details Only sets a flag and writes to a pipe, so it can be called from a signal handler.
+     */
+    void stop();
+
+    /**
+     * @brief Blocks of one connection received but not yet answered before its input
+     * stops being read, which bounds the memory a fast client can take
+     */
+    std::size_t maxPending = 256;
+
+protected:
+    struct Task {
+        uint64_t connection;
+        std::size_t seq;
+        std::vector<std::string> block;
+    };
+    struct Result {
+        uint64_t connection;
+        std::size_t seq;
+        std::string text;
+    };
+    struct Connection;
+
+    unsigned threads;
+    Solve solve;
+    int listenFd = -1;
+    int port = -1;
+    int wake[2] = {-1, -1};  // written by the workers and stop() to interrupt poll()
+    std::string unixPath;
+    std::atomic<bool> stopping{false};
+    BoundedQueue<Task> tasks;
+    std::mutex resultMutex;
+    std::vector<Result> results;
+
+    bool receive(uint64_t id, Connection &c);
+    void submit(uint64_t id, Connection &c);
+};
+
+#endif
@@ -0,0 +1,369 @@
+/**
+* @file CSRGraph.h
+ * @brief Immutable compressed-sparse-row snapshot of a Graph
+ *
+ * @details The pointer-based Graph keeps every Vertex and Edge in its own heap
+ * allocation, so a shortest path search spends most of its time chasing
+ * Edge* -> Vertex* pointers. CSRGraph copies the topology into contiguous
+ * arrays (offsets, targets and one weight array per metric) plus a reverse
+ * (incoming) CSR, and is what the routing algorithms iterate over.
+ */
+
+#ifndef DA_TP_CLASSES_CSRGRAPH
+#define DA_TP_CLASSES_CSRGRAPH
+
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "Graph.h"
+
+/**
+ * @struct CSRArrays
+ * @brief Views over the arrays of a CSRGraph
+ * @tparam T Type of vertex information
+ *
+ * @details The arrays may live in vectors owned by the graph or directly in a
+ * memory-mapped snapshot file (see graphSnapshot.h), so they are only seen
+ * through spans. n is the number of vertices and m the number of edges.
+ */
+template <class T>
+struct CSRArrays {
+    std::span<const T> info;            // n, vertex information (id)
+    std::span<const int> codeOffsets;   // n+1, code of v is codeChars[codeOffsets[v], codeOffsets[v+1])
+    std::span<const char> codeChars;    // all codes, concatenated
+    std::span<const char> parking;      // n, 1 if parking is available
+
+    std::span<const int> offsets;       // n+1, outgoing edges of v are [offsets[v], offsets[v+1])
+    std::span<const int> origins;       // m, origin vertex of each forward edge
+    std::span<const int> targets;       // m, destination vertex of each forward edge
+    std::span<const int> driving;       // m, driving time of each forward edge, -1 if not drivable
+    std::span<const int> walking;       // m, walking time of each forward edge, -1 if not walkable
+
+    std::span<const int> inOffsets;     // n+1, incoming edges of v are [inOffsets[v], inOffsets[v+1])
+    std::span<const int> inEdges;       // m, forward edge id of each incoming slot
+
+    std::span<const int> denseIdx;      // index of the vertex with id i, -1 if none (empty if ids are sparse)
+    std::span<const T> sortedInfo;      // ids in increasing order (only when denseIdx is empty)
+    std::span<const int> sortedIdx;     // index of the vertex with id sortedInfo[i]
+};
+
+/**
+ * @class CSRGraph
+ * @brief Read-only, array based copy of a Graph used by the search algorithms
+ * @tparam T Type of vertex information
+ *
+ * @details Vertices are numbered 0..n-1 in the order of Graph::getVertexSet(),
+ * and the outgoing edges of a vertex keep the order of Vertex::getAdj(), so a
+ * search over the snapshot visits edges exactly like a search over the Graph.
+ * - Forward edges of v are the ids outBegin(v) .. outEnd(v)-1
+ * - Incoming edges of v are the ids inBegin(v) .. inEnd(v)-1 in the reverse
+ *   arrays, in the order of Vertex::getIncoming()
+ * - A weight of -1 means the edge cannot be used with that metric
+ *
+ * Copies are cheap: they share the same (immutable) arrays.
+ */
+template <class T>
+class CSRGraph {
+public:
+    /**
+     * @brief Builds the snapshot from the current state of a graph
+     * @param g The graph to copy (vertex availability states included)
+     */
+    explicit CSRGraph(const Graph<T> &g);
+
+    /**
+     * @brief Wraps arrays that already have the CSR layout
+     * @param arrays Views over the arrays
+     * @param storage Keeps the memory behind the views alive (e.g. a file mapping)
+     */
+    CSRGraph(const CSRArrays<T> &arrays, std::shared_ptr<const void> storage);
+
+    int getNumVertex() const;
+    int getNumEdges() const;
+
+    /**
+     * @brief Finds the index of the vertex with a given content
+     * @param in Vertex information (id)
+     * @return Index of the vertex, or -1 if it does not exist
+     */
+    int findIdx(const T &in) const;
+
+    T getInfo(int v) const;
+    std::string_view getCode(int v) const;
+    bool getParking(int v) const;
+
+    /**
+     * @brief Gets the availability state copied from Vertex::getAvailable()
+     * @param v Vertex index
+     * @return -1 (blocked), 0 (normal) or 1 (required)
+     */
+    int getAvailable(int v) const;
+
+    int outBegin(int v) const;
+    int outEnd(int v) const;
+    int getOrig(int e) const;
+    int getDest(int e) const;
+    int getDrivingTime(int e) const;
+    int getWalkingTime(int e) const;
+
+    int inBegin(int v) const;
+    int inEnd(int v) const;
+
+    /**
+     * @brief Views the incoming edges of a vertex
+     * @param v Vertex index
+     * @return Forward edge ids of the slots inBegin(v) .. inEnd(v)-1
+     */
+    std::span<const int> inEdges(int v) const;
+
+    /**
+     * @brief Gets the forward edge that a reverse (incoming) slot refers to
+     * @param r Index in the reverse arrays
+     * @return Id of the same edge in the forward arrays
+     */
+    int getInEdge(int r) const;
+
+    /**
+     * @brief Gets the raw arrays, e.g. to write them to a snapshot file
+     */
+    const CSRArrays<T> &getArrays() const;
+
+protected:
+    CSRArrays<T> a;
+    std::shared_ptr<const void> storage;
+    std::vector<int> available; // empty when every vertex is available (state 0)
+};
+
+/**
+ * @struct CSRStorage
+ * @brief Owned arrays behind a CSRGraph built in memory
+ */
+template <class T>
+struct CSRStorage {
+    std::vector<T> info;
+    std::vector<int> codeOffsets;
+    std::vector<char> codeChars;
+    std::vector<char> parking;
+    std::vector<int> offsets, origins, targets, driving, walking;
+    std::vector<int> inOffsets, inEdges;
+    std::vector<int> denseIdx;
+    std::vector<T> sortedInfo;
+    std::vector<int> sortedIdx;
+};
+
+/**
+ * @brief Builds the id -> index lookup arrays of a CSR graph
+ * @tparam T Type of vertex information
+ * @param info Vertex information, by index
+ * @param denseIdx Output: direct table, filled when ids are integers close to [0, n)
+ * @param sortedInfo Output: sorted ids, filled otherwise
+ * @param sortedIdx Output: index of each id of sortedInfo
+ */
+template <class T>
+void buildIdIndex(const std::vector<T> &info, std::vector<int> &denseIdx, std::vector<T> &sortedInfo, std::vector<int> &sortedIdx) {
+    int n = info.size();
+    if constexpr (std::is_integral_v<T>) {
+        bool dense = std::all_of(info.begin(), info.end(), [n](const T &id) {
+            return id >= 0 && static_cast<std::size_t>(id) < 4 * (static_cast<std::size_t>(n) + 64);
+        });
+        if (dense) {
+            T maxId = n == 0 ? 0 : *std::max_element(info.begin(), info.end());
+            denseIdx.assign(maxId + 1, -1);
+            for (int i = 0; i < n; i++)
+                denseIdx[info[i]] = i;
+            return;
+        }
+    }
+    sortedIdx.resize(n);
+    for (int i = 0; i < n; i++)
+        sortedIdx[i] = i;
+    std::sort(sortedIdx.begin(), sortedIdx.end(), [&info](int x, int y) { return info[x] < info[y]; });
+    sortedInfo.reserve(n);
+    for (int i : sortedIdx)
+        sortedInfo.push_back(info[i]);
+}
+
+/************************* CSRGraph  **************************/
+
+template <class T>
+CSRGraph<T>::CSRGraph(const Graph<T> &g) {
+    auto s = std::make_shared<CSRStorage<T>>();
+    auto vertexSet = g.vertices();
+    int n = vertexSet.size();
+
+    s->info.reserve(n);
+    s->codeOffsets.reserve(n + 1);
+    s->parking.reserve(n);
+    s->codeOffsets.push_back(0);
+    bool allAvailable = true;
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        auto v = vertexSet[i];
+        s->info.push_back(v->getInfo());
+        std::string code = v->getCode();
+        s->codeChars.insert(s->codeChars.end(), code.begin(), code.end());
+        s->codeOffsets.push_back(s->codeChars.size());
+        s->parking.push_back(v->getParking());
+        allAvailable = allAvailable && v->getAvailable() == 0;
+        m += v->outEdges().size();
+    }
+    if (!allAvailable) {
+        available.reserve(n);
+        for (auto v : vertexSet)
+            available.push_back(v->getAvailable());
+    }
+    buildIdIndex(s->info, s->denseIdx, s->sortedInfo, s->sortedIdx);
+    a.denseIdx = s->denseIdx;
+    a.sortedInfo = s->sortedInfo;
+    a.sortedIdx = s->sortedIdx;
+
+    s->offsets.assign(n + 1, 0);
+    s->origins.reserve(m);
+    s->targets.reserve(m);
+    s->driving.reserve(m);
+    s->walking.reserve(m);
+    std::unordered_map<const Edge<T> *, int> edgeId;
+    edgeId.reserve(m);
+    for (int i = 0; i < n; i++) {
+        for (auto e : vertexSet[i]->outEdges()) {
+            edgeId.emplace(e, s->targets.size());
+            s->origins.push_back(i);
+            s->targets.push_back(findIdx(e->getDest()->getInfo()));
+            s->driving.push_back(e->getDrivingTime());
+            s->walking.push_back(e->getWalkingTime());
+        }
+        s->offsets[i + 1] = s->targets.size();
+    }
+
+    // Reverse CSR, keeping the order of Vertex::getIncoming()
+    s->inOffsets.assign(n + 1, 0);
+    s->inEdges.reserve(m);
+    for (int i = 0; i < n; i++) {
+        for (auto e : vertexSet[i]->inEdges())
+            s->inEdges.push_back(edgeId.at(e));
+        s->inOffsets[i + 1] = s->inEdges.size();
+    }
+
+    a.info = s->info;
+    a.codeOffsets = s->codeOffsets;
+    a.codeChars = s->codeChars;
+    a.parking = s->parking;
+    a.offsets = s->offsets;
+    a.origins = s->origins;
+    a.targets = s->targets;
+    a.driving = s->driving;
+    a.walking = s->walking;
+    a.inOffsets = s->inOffsets;
+    a.inEdges = s->inEdges;
+    storage = std::move(s);
+}
+
+template <class T>
+CSRGraph<T>::CSRGraph(const CSRArrays<T> &arrays, std::shared_ptr<const void> storage): a(arrays), storage(std::move(storage)) {}
+
+template <class T>
+int CSRGraph<T>::getNumVertex() const {
+    return a.info.size();
+}
+
+template <class T>
+int CSRGraph<T>::getNumEdges() const {
+    return a.targets.size();
+}
+
+template <class T>
+int CSRGraph<T>::findIdx(const T &in) const {
+    if (!a.denseIdx.empty()) {
+        if constexpr (std::is_integral_v<T>) {
+            if (in < 0 || static_cast<std::size_t>(in) >= a.denseIdx.size())
+                return -1;
+            return a.denseIdx[in];
+        }
+    }
+    auto it = std::lower_bound(a.sortedInfo.begin(), a.sortedInfo.end(), in);
+    if (it == a.sortedInfo.end() || *it != in)
+        return -1;
+    return a.sortedIdx[it - a.sortedInfo.begin()];
+}
+
+template <class T>
+T CSRGraph<T>::getInfo(int v) const {
+    return a.info[v];
+}
+
+template <class T>
+std::string_view CSRGraph<T>::getCode(int v) const {
+    return std::string_view(a.codeChars.data() + a.codeOffsets[v], a.codeOffsets[v + 1] - a.codeOffsets[v]);
+}
+
+template <class T>
+bool CSRGraph<T>::getParking(int v) const {
+    return a.parking[v];
+}
+
+template <class T>
+int CSRGraph<T>::getAvailable(int v) const {
+    return available.empty() ? 0 : available[v];
+}
+
+template <class T>
+int CSRGraph<T>::outBegin(int v) const {
+    return a.offsets[v];
+}
+
+template <class T>
+int CSRGraph<T>::outEnd(int v) const {
+    return a.offsets[v + 1];
+}
+
+template <class T>
+int CSRGraph<T>::getOrig(int e) const {
+    return a.origins[e];
+}
+
+template <class T>
+int CSRGraph<T>::getDest(int e) const {
+    return a.targets[e];
+}
+
+template <class T>
+int CSRGraph<T>::getDrivingTime(int e) const {
+    return a.driving[e];
+}
+
+template <class T>
+int CSRGraph<T>::getWalkingTime(int e) const {
+    return a.walking[e];
+}
+
+template <class T>
+int CSRGraph<T>::inBegin(int v) const {
+    return a.inOffsets[v];
+}
+
+template <class T>
+int CSRGraph<T>::inEnd(int v) const {
+    return a.inOffsets[v + 1];
+}
+
+template <class T>
+std::span<const int> CSRGraph<T>::inEdges(int v) const {
+    return a.inEdges.subspan(a.inOffsets[v], a.inOffsets[v + 1] - a.inOffsets[v]);
+}
+
+template <class T>
+int CSRGraph<T>::getInEdge(int r) const {
+    return a.inEdges[r];
+}
+
+template <class T>
+const CSRArrays<T> &CSRGraph<T>::getArrays() const {
+    return a;
+}
+
+#endif /* DA_TP_CLASSES_CSRGRAPH */
@@ -8,12 +8,31 @@
 #include <vector>
 #include <queue>
 #include <limits>
+#include <span>
 #include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include "../data_structures/MutablePriorityQueue.h" // not needed for now
+#include "ObjectPool.h"
 
 template <class T>
 class Edge;
 
+template <class T>
+class Graph;
+
+/**
+ * @brief Hash for std::string keys that also accepts std::string_view lookups
+ */
+struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
 #define INF std::numeric_limits<double>::max()
 
 /************************* Vertex  **************************/
@@ -22,29 +41,24 @@ template <class T>
 class Vertex {
 public:
     Vertex(T in);
-    bool operator<(Vertex<T> & vertex) const; // // required by MutablePriorityQueue
 
     T getInfo() const;
     std::vector<Edge<T> *> getAdj() const;
-    bool isVisited() const;
-    bool isProcessing() const;
-    unsigned int getIndegree() const;
-    double getDist() const;
-    Edge<T> *getPath() const;
     std::vector<Edge<T> *> getIncoming() const;
 
-    void setInfo(T info);
-    void setVisited(bool visited);
-    void setProcessing(bool processing);
+    /**
+    * @brief Views the outgoing edges without copying them
+    * @return The edges, in the order of getAdj(); invalidated when edges are added or removed
+    */
+    std::span<Edge<T> *const> outEdges() const;
 
-    int getLow() const;
-    void setLow(int value);
-    int getNum() const;
-    void setNum(int value);
+    /**
+    * @brief Views the incoming edges without copying them
+    * @return The edges, in the order of getIncoming(); invalidated when edges are added or removed
+    */
+    std::span<Edge<T> *const> inEdges() const;
 
-    void setIndegree(unsigned int indegree);
-    void setDist(double dist);
-    void setPath(Edge<T> *path);
+    void setInfo(T info);
     Edge<T> * addEdge(Vertex<T> *dest, int Driving, int Walking);
     bool removeEdge(T in);
     void removeOutgoingEdges();
@@ -102,22 +116,14 @@ public:
         return this->parking;
     }
 
-    friend class MutablePriorityQueue<Vertex>;
+    friend class Graph<T>;
 protected:
     T info;                // info node
     std::vector<Edge<T> *> adj;  // outgoing edges
 
-    // auxiliary fields
-    bool visited = false; // used by DFS, BFS, Prim ...
-    bool processing = false; // used by isDAG (in addition to the visited attribute)
-    int low = -1, num = -1; // used by SCC Tarjan
-    unsigned int indegree; // used by topsort
-    double dist = 0;
-    Edge<T> *path = nullptr;
-
     std::vector<Edge<T> *> incoming; // incoming edges
 
-    int queueIndex = 0; 		// required by MutablePriorityQueue and UFDS
+    ObjectPool<Edge<T>> *edgePool = nullptr; // edges of a vertex of a Graph live in its pool
 
     void deleteEdge(Edge<T> *edge);
 
@@ -210,7 +216,19 @@ protected:
 template <class T>
 class Graph {
 public:
+    Graph();
     ~Graph();
+
+    /**
+    * @brief Graphs own their vertices and edges, so they are moved, never copied
+    * @details Use vertices() or a const reference to look at a graph without copying it.
+    * Pointers to vertices and edges stay valid after a move.
+    */
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
+    Graph(Graph &&other) noexcept;
+    Graph &operator=(Graph &&other) noexcept;
+
     /*
     * Auxiliary function to find a vertex with a given the content.
     */
@@ -221,14 +239,31 @@ public:
     * @param in The alphanumeric code to search for
     * @return Pointer to the vertex if found, nullptr otherwise
     */
-    Vertex<T> *findCode(const std::string &in) const;
+    Vertex<T> *findCode(std::string_view in) const;
     /*
      *  Adds a vertex with a given content or info (in) to a graph (this).
      *  Returns true if successful, and false if a vertex with that content already exists.
      */
     bool addVertex(const T &in);
+
+    /**
+    * @brief Adds a vertex together with its location data
+    * @param in Vertex information (id)
+    * @param Location Human-readable location name
+    * @param Code Unique alphanumeric code, indexed for findCode()
+    * @param Parking true if parking is available at this location
+    * @return true if successful, false if a vertex with that content already exists
+    */
+    bool addVertex(const T &in, const std::string &Location, const std::string &Code, bool Parking);
     bool removeVertex(const T &in);
 
+    /**
+    * @brief Reserves room for a number of vertices and edges before a bulk load
+    * @param n Expected number of vertices
+    * @param m Expected number of edges still to add
+    */
+    void reserve(std::size_t n, std::size_t m = 0);
+
     /*
      * Adds an edge to a graph (this), given the contents of the source and
      * destination vertices and the edge weight (w).
@@ -241,6 +276,12 @@ public:
     int getNumVertex() const;
     std::vector<Vertex<T> *> getVertexSet() const;
 
+    /**
+    * @brief Views the vertices without copying them
+    * @return The vertices, in the order of getVertexSet(); invalidated when vertices are added or removed
+    */
+    std::span<Vertex<T> *const> vertices() const;
+
     /**
     * @var int Graph::includenodevar
     * @brief Special node inclusion flag for restricted routing
@@ -260,6 +301,15 @@ public:
     bool switchwalking = false; //false means driving true means walking
 
 protected:
+    /**
+    * @brief Memory of the vertices and edges, freed all at once with the graph
+    */
+    struct Storage {
+        ObjectPool<Vertex<T>> vertices;
+        ObjectPool<Edge<T>> edges;
+    };
+    std::unique_ptr<Storage> storage; // behind a pointer, so moves keep every address
+
     std::vector<Vertex<T> *> vertexSet;    // vertex set
 
     double ** distMatrix = nullptr;   // dist matrix for Floyd-Warshall
@@ -269,6 +319,41 @@ protected:
      * Finds the index of the vertex with a given content.
      */
     int findVertexIdx(const T &in) const;
+
+    /**
+    * @var std::vector<int> Graph::denseIdx
+    * @brief Slot in vertexSet of the vertex with id i, or -1
+    * @details Used for integer ids close to the range [0, number of vertices),
+    * like the ones in Locations.csv; any other id goes to sparseIdx.
+    */
+    std::vector<int> denseIdx;
+
+    /**
+    * @var std::unordered_map<T,int> Graph::sparseIdx
+    * @brief Slot in vertexSet of the vertices whose id does not fit denseIdx
+    */
+    std::unordered_map<T, int> sparseIdx;
+
+    /**
+    * @var std::unordered_map<std::string,int> Graph::codeIdx
+    * @brief Slot in vertexSet of the vertex with a given location code
+    */
+    std::unordered_map<std::string, int, StringHash, std::equal_to<>> codeIdx;
+
+    /*
+     * Registers the vertex stored at vertexSet[slot] in the id and code indexes.
+     */
+    void indexVertex(int slot);
+
+    /*
+     * Rebuilds the id and code indexes after slots of vertexSet have shifted.
+     */
+    void rebuildIndex();
+
+    /*
+     * Creates a vertex in the storage of the graph (not added to vertexSet).
+     */
+    Vertex<T> *newVertex(const T &in);
 };
 
 void deleteMatrix(int **m, int n);
@@ -285,7 +370,7 @@ Vertex<T>::Vertex(T in): info(in) {}
  */
 template <class T>
 Edge<T> * Vertex<T>::addEdge(Vertex<T> *d, int driving, int walking) {
-    auto newEdge = new Edge<T>(this, d, driving, walking);
+    auto newEdge = edgePool ? edgePool->create(this, d, driving, walking) : new Edge<T>(this, d, driving, walking);
     adj.push_back(newEdge);
     d->incoming.push_back(newEdge);
     return newEdge;
@@ -388,68 +473,28 @@ int Vertex<T>::getAvailable() const {
 }
 
 //
-template <class T>
-bool Vertex<T>::operator<(Vertex<T> & vertex) const {
-    return this->dist < vertex.dist;
-}
-
 template <class T>
 T Vertex<T>::getInfo() const {
     return this->info;
 }
 
-template <class T>
-int Vertex<T>::getLow() const {
-    return this->low;
-}
-
-template <class T>
-void Vertex<T>::setLow(int value) {
-    this->low = value;
-}
-
-template <class T>
-int Vertex<T>::getNum() const {
-    return this->num;
-}
-
-template <class T>
-void Vertex<T>::setNum(int value) {
-    this->num = value;
-}
-
 template <class T>
 std::vector<Edge<T>*> Vertex<T>::getAdj() const {
     return this->adj;
 }
 
 template <class T>
-bool Vertex<T>::isVisited() const {
-    return this->visited;
-}
-
-template <class T>
-bool Vertex<T>::isProcessing() const {
-    return this->processing;
-}
-
-template <class T>
-unsigned int Vertex<T>::getIndegree() const {
-    return this->indegree;
-}
-
-template <class T>
-double Vertex<T>::getDist() const {
-    return this->dist;
+std::vector<Edge<T> *> Vertex<T>::getIncoming() const {
+    return this->incoming;
 }
 
 template <class T>
-Edge<T> *Vertex<T>::getPath() const {
-    return this->path;
+std::span<Edge<T> *const> Vertex<T>::outEdges() const {
+    return this->adj;
 }
 
 template <class T>
-std::vector<Edge<T> *> Vertex<T>::getIncoming() const {
+std::span<Edge<T> *const> Vertex<T>::inEdges() const {
     return this->incoming;
 }
 
@@ -458,31 +503,6 @@ void Vertex<T>::setInfo(T in) {
     this->info = in;
 }
 
-template <class T>
-void Vertex<T>::setVisited(bool visited) {
-    this->visited = visited;
-}
-
-template <class T>
-void Vertex<T>::setProcessing(bool processing) {
-    this->processing = processing;
-}
-
-template <class T>
-void Vertex<T>::setIndegree(unsigned int indegree) {
-    this->indegree = indegree;
-}
-
-template <class T>
-void Vertex<T>::setDist(double dist) {
-    this->dist = dist;
-}
-
-template <class T>
-void Vertex<T>::setPath(Edge<T> *path) {
-    this->path = path;
-}
-
 template <class T>
 void Vertex<T>::deleteEdge(Edge<T> *edge) {
     Vertex<T> *dest = edge->getDest();
@@ -496,7 +516,10 @@ void Vertex<T>::deleteEdge(Edge<T> *edge) {
             it++;
         }
     }
-    delete edge;
+    if (edgePool)
+        edgePool->destroy(edge);
+    else
+        delete edge;
 }
 
 /********************** Edge  ****************************/
@@ -574,24 +597,33 @@ std::vector<Vertex<T> *> Graph<T>::getVertexSet() const {
     return vertexSet;
 }
 
+template <class T>
+std::span<Vertex<T> *const> Graph<T>::vertices() const {
+    return vertexSet;
+}
+
 /*
  * Auxiliary function to find a vertex with a given content.
  */
 template <class T>
 Vertex<T> * Graph<T>::findVertex(const T &in) const {
-    for (auto v : vertexSet)
-        if (v->getInfo() == in)
-            return v;
-    return nullptr;
+    int slot = findVertexIdx(in);
+    return slot == -1 ? nullptr : vertexSet[slot];
 }
 
 /**
  * @brief Finds a vertex by its unique location code
  * @param in The alphanumeric code to search for
  * @return Pointer to the vertex if found, nullptr if not found
+ *
+ * @details Constant time through codeIdx. Codes changed directly with
+ * Vertex::setCode() are not indexed, so a miss falls back to a linear scan.
  */
 template<class T>
-Vertex<T> * Graph<T>::findCode(const std::string &in) const {
+Vertex<T> * Graph<T>::findCode(std::string_view in) const {
+    auto it = codeIdx.find(in);
+    if (it != codeIdx.end() && vertexSet[it->second]->getCode() == in)
+        return vertexSet[it->second];
     for (auto v : vertexSet)
         if (v->getCode() == in)
             return v;
@@ -603,11 +635,69 @@ Vertex<T> * Graph<T>::findCode(const std::string &in) const {
  */
 template <class T>
 int Graph<T>::findVertexIdx(const T &in) const {
+    if constexpr (std::is_integral_v<T>) {
+        if (in >= 0 && static_cast<std::size_t>(in) < denseIdx.size() && denseIdx[in] != -1)
+            return denseIdx[in];
+    }
+    auto it = sparseIdx.find(in);
+    return it == sparseIdx.end() ? -1 : it->second;
+}
+
+/*
+ * Registers the vertex stored at vertexSet[slot] in the id and code indexes.
+ * Integer ids below four times the number of vertices go to the direct table,
+ * which keeps it proportional to the graph even when ids have gaps.
+ */
+template <class T>
+void Graph<T>::indexVertex(int slot) {
+    auto v = vertexSet[slot];
+    bool dense = false;
+    if constexpr (std::is_integral_v<T>) {
+        T in = v->getInfo();
+        if (in >= 0 && static_cast<std::size_t>(in) < 4 * (vertexSet.size() + 64)) {
+            if (static_cast<std::size_t>(in) >= denseIdx.size())
+                denseIdx.resize(std::max<std::size_t>(in + 1, 2 * denseIdx.size()), -1);
+            denseIdx[in] = slot;
+            dense = true;
+        }
+    }
+    if (!dense)
+        sparseIdx[v->getInfo()] = slot;
+    if (!v->getCode().empty())
+        codeIdx[v->getCode()] = slot;
+}
+
+/*
+ * Rebuilds the id and code indexes after slots of vertexSet have shifted.
+ */
+template <class T>
+void Graph<T>::rebuildIndex() {
+    denseIdx.clear();
+    sparseIdx.clear();
+    codeIdx.clear();
     for (unsigned i = 0; i < vertexSet.size(); i++)
-        if (vertexSet[i]->getInfo() == in)
-            return i;
-    return -1;
+        indexVertex(i);
 }
+
+/**
+ * @brief Reserves room for a number of vertices before a bulk load
+ * @param n Expected number of vertices
+ */
+template <class T>
+void Graph<T>::reserve(std::size_t n, std::size_t m) {
+    if (!storage)
+        storage = std::make_unique<Storage>();
+    if (n > vertexSet.size())
+        storage->vertices.reserve(n - vertexSet.size());
+    storage->edges.reserve(m);
+    vertexSet.reserve(n);
+    codeIdx.reserve(n);
+    if constexpr (std::is_integral_v<T>)
+        denseIdx.reserve(n + 1);
+    else
+        sparseIdx.reserve(n);
+}
+
 /*
  *  Adds a vertex with a given content or info (in) to a graph (this).
  *  Returns true if successful, and false if a vertex with that content already exists.
@@ -616,7 +706,29 @@ template <class T>
 bool Graph<T>::addVertex(const T &in) {
     if (findVertex(in) != nullptr)
         return false;
-    vertexSet.push_back(new Vertex<T>(in));
+    vertexSet.push_back(newVertex(in));
+    indexVertex(vertexSet.size() - 1);
+    return true;
+}
+
+/**
+ * @brief Adds a vertex together with its location data
+ * @param in Vertex information (id)
+ * @param Location Human-readable location name
+ * @param Code Unique alphanumeric code, indexed for findCode()
+ * @param Parking true if parking is available at this location
+ * @return true if successful, false if a vertex with that content already exists
+ */
+template <class T>
+bool Graph<T>::addVertex(const T &in, const std::string &Location, const std::string &Code, bool Parking) {
+    if (findVertex(in) != nullptr)
+        return false;
+    auto v = newVertex(in);
+    v->setLocation(Location);
+    v->setCode(Code);
+    v->setParking(Parking);
+    vertexSet.push_back(v);
+    indexVertex(vertexSet.size() - 1);
     return true;
 }
 
@@ -635,7 +747,8 @@ bool Graph<T>::removeVertex(const T &in) {
                 u->removeEdge(v->getInfo());
             }
             vertexSet.erase(it);
-            delete v;
+            storage->vertices.destroy(v);
+            rebuildIndex();
             return true;
         }
     }
@@ -703,6 +816,51 @@ inline void deleteMatrix(double **m, int n) {
     }
 }
 
+template <class T>
+Graph<T>::Graph(): storage(std::make_unique<Storage>()) {}
+
+template <class T>
+Graph<T>::Graph(Graph &&other) noexcept {
+    *this = std::move(other);
+}
+
+/*
+ * Takes the vertices, edges and matrices of other, which is left empty.
+ */
+template <class T>
+Graph<T> &Graph<T>::operator=(Graph &&other) noexcept {
+    if (this == &other)
+        return *this;
+    deleteMatrix(distMatrix, vertexSet.size());
+    deleteMatrix(pathMatrix, vertexSet.size());
+    storage = std::move(other.storage);
+    vertexSet = std::exchange(other.vertexSet, {});
+    distMatrix = std::exchange(other.distMatrix, nullptr);
+    pathMatrix = std::exchange(other.pathMatrix, nullptr);
+    denseIdx = std::exchange(other.denseIdx, {});
+    sparseIdx = std::exchange(other.sparseIdx, {});
+    codeIdx = std::exchange(other.codeIdx, {});
+    includenodevar = other.includenodevar;
+    switchwalking = other.switchwalking;
+    return *this;
+}
+
+/*
+ * Creates a vertex in the storage of the graph (not added to vertexSet).
+ */
+template <class T>
+Vertex<T> *Graph<T>::newVertex(const T &in) {
+    if (!storage)
+        storage = std::make_unique<Storage>(); // a moved-from graph being reused
+    Vertex<T> *v = storage->vertices.create(in);
+    v->edgePool = &storage->edges;
+    return v;
+}
+
+/*
+ * The matrices are the only memory outside of storage; the vertices and
+ * edges are freed together with it.
+ */
 template <class T>
 Graph<T>::~Graph() {
     deleteMatrix(distMatrix, vertexSet.size());
@@ -0,0 +1,311 @@
+/**
+ * @file IndexPriorityQueues.h
+ * @brief Alternative queue policies for the searches of a SearchContext
+ *
+ * @details Every queue has the interface of MutableIndexPriorityQueue: elements are
+ * vertex indices, keys are read from an external array when an element is inserted
+ * or decreased, and reset(n) empties the queue for a new search. They are meant for
+ * Dijkstra (keys never go below the last extracted one, and are small whole minutes):
+ * - DaryIndexPriorityQueue: D-ary heap of (key, vertex) pairs, no key array lookups
+ *   while sifting and half the depth of a binary heap.
+ * - RadixIndexPriorityQueue: radix heap, O(log C) amortized per vertex.
+ * - BucketIndexPriorityQueue: Dial's buckets, one per key value, in a ring.
+ * The radix and bucket queues don't move entries on decreaseKey: they add a new
+ * one and skip the outdated ones when extracting.
+ * Among equal keys they extract vertices in another order than the binary heap.
+ */
+
+#ifndef DA_TP_CLASSES_INDEXPRIORITYQUEUES
+#define DA_TP_CLASSES_INDEXPRIORITYQUEUES
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MutablePriorityQueue.h"
+
+/**
+ * @class DaryIndexPriorityQueue
+ * @brief Indexed D-ary min-heap that keeps the key next to each element
+ */
+template <class K, unsigned D = 4>
+class DaryIndexPriorityQueue {
+    std::vector<std::pair<K, int>> H;   // 0-indexed, children of i are D*i+1 .. D*i+D
+    std::vector<unsigned> queueIndex;
+    const std::vector<K> &key;
+    void heapifyUp(unsigned i);
+    void heapifyDown(unsigned i);
+    inline void set(unsigned i, const std::pair<K, int> &x);
+public:
+    DaryIndexPriorityQueue(const std::vector<K> &key);
+    void insert(int x);
+    int extractMin();
+    void decreaseKey(int x);
+    bool empty();
+    void reset(std::size_t n);
+};
+
+template <class K, unsigned D>
+DaryIndexPriorityQueue<K, D>::DaryIndexPriorityQueue(const std::vector<K> &key): key(key) {}
+
+template <class K, unsigned D>
+bool DaryIndexPriorityQueue<K, D>::empty() {
+    return H.empty();
+}
+
+template <class K, unsigned D>
+void DaryIndexPriorityQueue<K, D>::reset(std::size_t n) {
+    H.clear();
+    if (queueIndex.size() < n) queueIndex.resize(n, 0);
+}
+
+template <class K, unsigned D>
+int DaryIndexPriorityQueue<K, D>::extractMin() {
+    int x = H[0].second;
+    H[0] = H.back();
+    H.pop_back();
+    if (!H.empty()) heapifyDown(0);
+    return x;
+}
+
+template <class K, unsigned D>
+void DaryIndexPriorityQueue<K, D>::insert(int x) {
+    H.push_back({key[x], x});
+    heapifyUp(H.size() - 1);
+}
+
+template <class K, unsigned D>
+void DaryIndexPriorityQueue<K, D>::decreaseKey(int x) {
+    unsigned i = queueIndex[x];
+    H[i].first = key[x];
+    heapifyUp(i);
+}
+
+template <class K, unsigned D>
+void DaryIndexPriorityQueue<K, D>::heapifyUp(unsigned i) {
+    auto x = H[i];
+    while (i > 0 && x < H[(i - 1) / D]) {
+        set(i, H[(i - 1) / D]);
+        i = (i - 1) / D;
+    }
+    set(i, x);
+}
+
+template <class K, unsigned D>
+void DaryIndexPriorityQueue<K, D>::heapifyDown(unsigned i) {
+    auto x = H[i];
+    while (true) {
+        std::size_t first = (std::size_t) D * i + 1;
+        if (first >= H.size())
+            break;
+        std::size_t last = std::min(first + D, H.size());
+        std::size_t k = first;
+        for (std::size_t c = first + 1; c < last; c++) {
+            if (H[c] < H[k]) k = c;
+        }
+        if ( ! (H[k] < x) )
+            break;
+        set(i, H[k]);
+        i = k;
+    }
+    set(i, x);
+}
+
+template <class K, unsigned D>
+void DaryIndexPriorityQueue<K, D>::set(unsigned i, const std::pair<K, int> &x) {
+    H[i] = x;
+    queueIndex[x.second] = i;
+}
+
+
+/**
+ * @class RadixIndexPriorityQueue
+ * @brief Radix heap for non-negative integer keys extracted in non-decreasing order
+ *
+ * @details Bucket b holds the entries whose key first differs from the last extracted
+ * key at bit b-1 (bucket 0: equal keys). Extracting from an empty bucket 0 takes the
+ * smallest key of the first non-empty bucket and spreads that bucket over the lower
+ * ones, so each entry moves at most once per bit.
+ */
+template <class K>
+class RadixIndexPriorityQueue {
+    static_assert(std::is_integral<K>::value, "RadixIndexPriorityQueue needs integer keys");
+    static const unsigned numBuckets = sizeof(K) * CHAR_BIT + 1;
+    std::vector<std::pair<K, int>> buckets[numBuckets];
+    const std::vector<K> &key;
+    K last = 0;
+    std::size_t size = 0;   // vertices in the queue, outdated entries not counted
+    unsigned bucketOf(K k) const;
+    void push(int x);
+public:
+    RadixIndexPriorityQueue(const std::vector<K> &key);
+    void insert(int x);
+    int extractMin();
+    void decreaseKey(int x);
+    bool empty();
+    void reset(std::size_t n);
+};
+
+template <class K>
+RadixIndexPriorityQueue<K>::RadixIndexPriorityQueue(const std::vector<K> &key): key(key) {}
+
+template <class K>
+bool RadixIndexPriorityQueue<K>::empty() {
+    return size == 0;
+}
+
+template <class K>
+void RadixIndexPriorityQueue<K>::reset(std::size_t) {
+    for (auto &bucket : buckets) bucket.clear();
+    last = 0;
+    size = 0;
+}
+
+template <class K>
+unsigned RadixIndexPriorityQueue<K>::bucketOf(K k) const {
+    return std::bit_width((typename std::make_unsigned<K>::type) (k ^ last));
+}
+
+template <class K>
+void RadixIndexPriorityQueue<K>::push(int x) {
+    buckets[bucketOf(key[x])].push_back({key[x], x});
+}
+
+template <class K>
+void RadixIndexPriorityQueue<K>::insert(int x) {
+    push(x);
+    size++;
+}
+
+template <class K>
+void RadixIndexPriorityQueue<K>::decreaseKey(int x) {
+    push(x);
+}
+
+template <class K>
+int RadixIndexPriorityQueue<K>::extractMin() {
+    while (true) {
+        while (!buckets[0].empty()) {
+            auto entry = buckets[0].back();
+            buckets[0].pop_back();
+            if (entry.first == key[entry.second]) {
+                size--;
+                return entry.second;
+            }
+        }
+        unsigned b = 1;
+        while (buckets[b].empty()) b++;
+        std::vector<std::pair<K, int>> &moving = buckets[b];
+        bool found = false;
+        for (const auto &entry : moving) {
+            if (entry.first == key[entry.second] && (!found || entry.first < last)) {
+                last = entry.first;
+                found = true;
+            }
+        }
+        if (found) {
+            // the entries now share the bits above b-1 with last, so they all go to lower buckets
+            for (const auto &entry : moving) {
+                if (entry.first == key[entry.second]) buckets[bucketOf(entry.first)].push_back(entry);
+            }
+        }
+        moving.clear();
+    }
+}
+
+
+/**
+ * @class BucketIndexPriorityQueue
+ * @brief Dial's bucket queue for small non-negative integer keys
+ *
+ * @details A ring of buckets, one per key value, scanned upwards from the last
+ * extracted key. The ring only has to span the largest edge weight, which isn't
+ * known in advance: it doubles whenever an inserted key would wrap around it.
+ */
+template <class K>
+class BucketIndexPriorityQueue {
+    static_assert(std::is_integral<K>::value, "BucketIndexPriorityQueue needs integer keys");
+    std::vector<std::vector<std::pair<K, int>>> buckets;
+    const std::vector<K> &key;
+    K current = std::numeric_limits<K>::max();  // no entry has a smaller key
+    std::size_t size = 0;   // vertices in the queue, outdated entries not counted
+    void push(int x);
+    void grow(K k);
+public:
+    BucketIndexPriorityQueue(const std::vector<K> &key);
+    void insert(int x);
+    int extractMin();
+    void decreaseKey(int x);
+    bool empty();
+    void reset(std::size_t n);
+};
+
+template <class K>
+BucketIndexPriorityQueue<K>::BucketIndexPriorityQueue(const std::vector<K> &key): buckets(64), key(key) {}
+
+template <class K>
+bool BucketIndexPriorityQueue<K>::empty() {
+    return size == 0;
+}
+
+template <class K>
+void BucketIndexPriorityQueue<K>::reset(std::size_t) {
+    for (auto &bucket : buckets) bucket.clear();
+    current = std::numeric_limits<K>::max();
+    size = 0;
+}
+
+template <class K>
+void BucketIndexPriorityQueue<K>::grow(K k) {
+    std::size_t n = buckets.size();
+    while ((std::size_t) (k - current) >= n) n *= 2;
+    std::vector<std::vector<std::pair<K, int>>> ring(n);
+    for (auto &bucket : buckets) {
+        for (const auto &entry : bucket) {
+            if (entry.first == key[entry.second]) ring[entry.first % n].push_back(entry);
+        }
+    }
+    buckets.swap(ring);
+}
+
+template <class K>
+void BucketIndexPriorityQueue<K>::push(int x) {
+    K k = key[x];
+    if (size == 0 && k < current) current = k; // first key of the search, whatever is left is outdated
+    if ((std::size_t) (k - current) >= buckets.size()) grow(k);
+    buckets[k % buckets.size()].push_back({k, x});
+}
+
+template <class K>
+void BucketIndexPriorityQueue<K>::insert(int x) {
+    push(x);
+    size++;
+}
+
+template <class K>
+void BucketIndexPriorityQueue<K>::decreaseKey(int x) {
+    push(x);
+}
+
+template <class K>
+int BucketIndexPriorityQueue<K>::extractMin() {
+    while (true) {
+        auto &bucket = buckets[current % buckets.size()];
+        while (!bucket.empty()) {
+            auto entry = bucket.back();
+            bucket.pop_back();
+            if (entry.first == key[entry.second]) {
+                size--;
+                return entry.second;
+            }
+        }
+        current++;
+    }
+}
+
+#endif /* DA_TP_CLASSES_INDEXPRIORITYQUEUES */
@@ -0,0 +1,110 @@
+/**
+* @file MappedFile.cpp
+ * @brief Implementation of the read-only file mapping
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+#include "./MappedFile.h"
+
+/**
+ * @brief Maps a file, or reads it into memory when mmap is not available
+ * @param filename Path of the file to map
+ * @param access How the mapping will be read; only a hint, ignored without mmap
+ */
+MappedFile::MappedFile(const std::string &filename, Access access) {
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        length = st.st_size;
+        if (length == 0) {
+            open = true;
+        } else {
+            void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                if (access == Access::Sequential) {
+                    madvise(p, length, MADV_SEQUENTIAL);
+                }
+                begin = static_cast<const char *>(p);
+                open = mapped = true;
+            }
+        }
+    }
+    ::close(fd);
+    if (open) {
+        return;
+    }
+#endif
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    buffer = contents.str();
+    begin = buffer.data();
+    length = buffer.size();
+    open = true;
+}
+
+MappedFile::~MappedFile() {
+#ifdef MAPPED_FILE_MMAP
+    if (mapped) {
+        munmap(const_cast<char *>(begin), length);
+    }
+#endif
+}
+
+bool MappedFile::isOpen() const {
+    return open;
+}
+
+const char *MappedFile::data() const {
+    return begin;
+}
+
+std::size_t MappedFile::size() const {
+    return length;
+}
+
+/**
+ * @brief Creates the file exclusively, named after the process id and a counter
+ * @details Unlike mkstemp, the file gets the same permissions as one made by ofstream.
+ */
+std::string temporaryFileName(const std::string &fileName) {
+    static std::atomic<unsigned> counter = 0;
+#ifdef MAPPED_FILE_MMAP
+    std::string prefix = fileName + ".tmp." + std::to_string(::getpid()) + ".";
+    for (int attempt = 0; attempt < 100; attempt++) {
+        std::string name = prefix + std::to_string(counter++);
+        int fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+        if (fd != -1) {
+            ::close(fd);
+            return name;
+        }
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+    return "";
+#else
+    std::random_device random;
+    return fileName + ".tmp." + std::to_string(random()) + "." + std::to_string(counter++);
+#endif
+}
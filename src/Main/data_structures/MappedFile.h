@@ -0,0 +1,65 @@
+/**
+* @file MappedFile.h
+ * @brief Read-only memory mapping of a file
+ */
+
+#ifndef SRC_MAPPED_FILE_H
+#define SRC_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole file
+ *
+ * @details Uses mmap on POSIX systems and falls back to reading the file into
+ * memory elsewhere. The mapping is released by the destructor.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief How the mapping will be read, passed on to the kernel as a paging hint
+     */
+    enum class Access {
+        Normal,     ///< no hint: default read-ahead, e.g. for lookups in a snapshot
+        Sequential  ///< read once from start to end, e.g. a CSV being parsed
+    };
+
+    /**
+     * @brief Maps a file
+     * @param filename Path of the file to map
+     * @param access How the mapping will be read
+     */
+    explicit MappedFile(const std::string &filename, Access access = Access::Normal);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief Checks whether the file could be opened and mapped
+     * @return true if data() is usable (an empty file is still open)
+     */
+    bool isOpen() const;
+    const char *data() const;
+    std::size_t size() const;
+
+private:
+    const char *begin = nullptr;
+    std::size_t length = 0;
+    bool open = false;
+    bool mapped = false;
+    std::string buffer; // contents when mmap is not available
+};
+
+/**
+ * @brief Creates an empty file with a unique name next to a file about to be replaced
+ * @param fileName Path of the file that will be replaced
+ * @return Path of the new file, fileName + ".tmp." + a unique suffix, or "" on error
+ *
+ * @details Write into it and rename it to fileName: two processes rebuilding the
+ * same file at once then never write into each other's temporary file.
+ */
+std::string temporaryFileName(const std::string &fileName);
+
+#endif
@@ -99,4 +99,109 @@ void MutablePriorityQueue<T>::set(unsigned i, T * x) {
     x->queueIndex = i;
 }
 
+
+/**
+ * Variant of MutablePriorityQueue for array based graphs (CSRGraph).
+ * Elements are vertex indices in [0, n) and their keys are read from an external
+ * array, so neither the key nor the queue index has to live inside a Vertex.
+ * Uses the same heap layout and comparisons as MutablePriorityQueue, so both
+ * extract vertices with equal keys in the same order.
+ */
+
+template <class K>
+class MutableIndexPriorityQueue {
+    std::vector<int> H;
+    std::vector<unsigned> queueIndex;
+    const std::vector<K> &key;
+    void heapifyUp(unsigned i);
+    void heapifyDown(unsigned i);
+    inline void set(unsigned i, int x);
+public:
+    MutableIndexPriorityQueue(const std::vector<K> &key);
+    void insert(int x);
+    int extractMin();
+    int top() const;
+    void decreaseKey(int x);
+    bool empty();
+    void reset(std::size_t n);
+};
+
+template <class K>
+MutableIndexPriorityQueue<K>::MutableIndexPriorityQueue(const std::vector<K> &key): queueIndex(key.size(), 0), key(key) {
+    H.push_back(-1);
+}
+
+template <class K>
+bool MutableIndexPriorityQueue<K>::empty() {
+    return H.size() == 1;
+}
+
+template <class K>
+int MutableIndexPriorityQueue<K>::extractMin() {
+    auto x = H[1];
+    H[1] = H.back();
+    H.pop_back();
+    if(H.size() > 1) heapifyDown(1);
+    queueIndex[x] = 0;
+    return x;
+}
+
+/**
+ * Empties the queue and makes room for the elements 0 .. n-1, keeping the memory.
+ */
+template <class K>
+void MutableIndexPriorityQueue<K>::reset(std::size_t n) {
+    H.resize(1);
+    if (queueIndex.size() < n) queueIndex.resize(n, 0);
+}
+
+template <class K>
+int MutableIndexPriorityQueue<K>::top() const {
+    return H[1];
+}
+
+template <class K>
+void MutableIndexPriorityQueue<K>::insert(int x) {
+    H.push_back(x);
+    heapifyUp(H.size()-1);
+}
+
+template <class K>
+void MutableIndexPriorityQueue<K>::decreaseKey(int x) {
+    heapifyUp(queueIndex[x]);
+}
+
+template <class K>
+void MutableIndexPriorityQueue<K>::heapifyUp(unsigned i) {
+    auto x = H[i];
+    while (i > 1 && key[x] < key[H[parent(i)]]) {
+        set(i, H[parent(i)]);
+        i = parent(i);
+    }
+    set(i, x);
+}
+
+template <class K>
+void MutableIndexPriorityQueue<K>::heapifyDown(unsigned i) {
+    auto x = H[i];
+    while (true) {
+        unsigned k = leftChild(i);
+        if (k >= H.size())
+            break;
+        if (k+1 < H.size() && key[H[k+1]] < key[H[k]])
+            ++k; // right child of i
+        if ( ! (key[H[k]] < key[x]) )
+            break;
+        set(i, H[k]);
+        i = k;
+    }
+    set(i, x);
+}
+
+template <class K>
+void MutableIndexPriorityQueue<K>::set(unsigned i, int x) {
+    H[i] = x;
+    queueIndex[x] = i;
+}
+
 #endif /* DA_TP_CLASSES_MUTABLEPRIORITYQUEUE */
\ No newline at end of file
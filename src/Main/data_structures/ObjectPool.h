@@ -0,0 +1,132 @@
+/**
+ * @file ObjectPool.h
+ * @brief Chunked storage for the vertices and edges of a Graph
+ *
+ * @details Objects are constructed inside large chunks instead of one heap block
+ * each, so the elements of a graph sit next to each other in memory and the whole
+ * pool goes away with a handful of frees. Addresses never change: the chunks are
+ * not reallocated, and the pool itself can't be copied.
+ */
+
+#ifndef DA_TP_CLASSES_OBJECTPOOL
+#define DA_TP_CLASSES_OBJECTPOOL
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ObjectPool
+ * @brief Owns objects of one type, allocated in chunks and recycled through a free list
+ * @tparam U Type of the objects
+ *
+ * @details Chunks double in size (starting at 64 objects), or fit the number given
+ * to reserve(). Objects still alive when the pool is destroyed are destroyed with it.
+ */
+template <class U>
+class ObjectPool {
+public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+    ~ObjectPool();
+
+    /**
+     * @brief Makes room for n more objects in a single chunk
+     * @param n Number of objects about to be created
+     */
+    void reserve(std::size_t n);
+
+    /**
+     * @brief Constructs an object in the pool
+     * @param args Arguments of the constructor of U
+     * @return The object, valid until destroy() or the end of the pool
+     */
+    template <class... Args>
+    U *create(Args &&... args);
+
+    /**
+     * @brief Destroys an object created by this pool, and recycles its slot
+     * @param object The object
+     */
+    void destroy(U *object);
+
+    /**
+     * @brief Gets the number of objects alive
+     */
+    std::size_t size() const;
+
+protected:
+    struct Slot {
+        alignas(U) unsigned char storage[sizeof(U)]; // first member: the object's address is the slot's
+        Slot *nextFree = nullptr;
+        bool live = false;
+    };
+    struct Chunk {
+        std::unique_ptr<Slot[]> slots;
+        std::size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    std::size_t used = 0;       // slots of the last chunk handed out
+    std::size_t reserved = 0;   // minimum size of the next chunk
+    std::size_t live = 0;
+    Slot *freeList = nullptr;
+};
+
+template <class U>
+ObjectPool<U>::~ObjectPool() {
+    for (std::size_t c = 0; c < chunks.size(); c++) {
+        std::size_t n = c + 1 == chunks.size() ? used : chunks[c].size;
+        for (std::size_t i = 0; i < n; i++) {
+            Slot &slot = chunks[c].slots[i];
+            if (slot.live) std::launder(reinterpret_cast<U *>(slot.storage))->~U();
+        }
+    }
+}
+
+template <class U>
+void ObjectPool<U>::reserve(std::size_t n) {
+    if (chunks.empty() || chunks.back().size - used < n) reserved = std::max(reserved, n);
+}
+
+template <class U>
+template <class... Args>
+U *ObjectPool<U>::create(Args &&... args) {
+    Slot *slot = freeList;
+    if (slot != nullptr) {
+        freeList = slot->nextFree;
+    } else {
+        if (chunks.empty() || used == chunks.back().size) {
+            std::size_t size = std::max<std::size_t>({64, reserved, chunks.empty() ? 0 : 2 * chunks.back().size});
+            chunks.push_back({std::unique_ptr<Slot[]>(new Slot[size]), size});
+            used = 0;
+            reserved = 0;
+        }
+        slot = &chunks.back().slots[used++];
+    }
+    U *object = new (slot->storage) U(std::forward<Args>(args)...);
+    slot->live = true;
+    live++;
+    return object;
+}
+
+template <class U>
+void ObjectPool<U>::destroy(U *object) {
+    Slot *slot = reinterpret_cast<Slot *>(reinterpret_cast<unsigned char *>(object));
+    object->~U();
+    slot->live = false;
+    slot->nextFree = freeList;
+    freeList = slot;
+    live--;
+}
+
+template <class U>
+std::size_t ObjectPool<U>::size() const {
+    return live;
+}
+
+#endif /* DA_TP_CLASSES_OBJECTPOOL */
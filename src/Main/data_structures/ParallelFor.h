@@ -0,0 +1,43 @@
+/**
+ * @file ParallelFor.h
+ * @brief Runs the iterations of a loop on a few threads
+ *
+ * @details Used by the preprocessing and table computations, whose iterations
+ * (one search, one row of blocks...) are independent and take similar time.
+ * Threads take the next iteration from a shared counter, so uneven iterations
+ * still balance.
+ */
+
+#ifndef DA_TP_CLASSES_PARALLELFOR
+#define DA_TP_CLASSES_PARALLELFOR
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Calls fn(i) for every i < count, on up to threads threads
+ * @param count Number of calls
+ * @param threads Maximum number of threads, 0 or 1 to run everything on the calling thread
+ * @param fn void(size_t i), thread safe for different i
+ */
+template <class F>
+void parallelFor(std::size_t count, unsigned threads, F fn) {
+    unsigned workers = (unsigned) std::min<std::size_t>(threads, count);
+    if (workers <= 1) {
+        for (std::size_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        for (std::size_t i = next++; i < count; i = next++) fn(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned w = 1; w < workers; w++) pool.emplace_back(work);
+    work();
+    for (std::thread &t : pool) t.join();
+}
+
+#endif /* DA_TP_CLASSES_PARALLELFOR */
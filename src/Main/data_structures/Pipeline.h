@@ -0,0 +1,195 @@
+/**
+ * @file Pipeline.h
+ * @brief Streaming reader -> solvers -> writer pipeline that writes results in input order
+ *
+ * @details Used by batch mode: blocks are read and parsed by one thread, solved
+ * concurrently by a pool of workers, and written by one thread, so reading, solving
+ * and writing overlap and the input never has to be fully in memory. The stages are
+ * connected by bounded queues. Results that finish early wait in a reorder buffer
+ * until all the ones before them have been written, and are written in large chunks
+ * with no flush until the end.
+ */
+
+#ifndef DA_TP_CLASSES_PIPELINE
+#define DA_TP_CLASSES_PIPELINE
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @class BoundedQueue
+ * @brief Thread safe FIFO queue with a maximum size
+ * @tparam T Type of the items
+ */
+template <class T>
+class BoundedQueue {
+public:
+    /**
+     * @param capacity Maximum number of items, push() waits while it is reached
+     */
+    explicit BoundedQueue(std::size_t capacity) : capacity(capacity ? capacity : 1) {}
+
+    /**
+     * @brief Adds an item, waiting while the queue is full
+     */
+    void push(T item);
+
+    /**
+     * @brief Removes the oldest item, waiting while the queue is empty
+     * @param item Output: the item
+     * @return false once the queue is closed and empty
+     */
+    bool pop(T &item);
+
+    /**
+     * @brief Marks the end of the items: pop() returns false once the rest are taken
+     */
+    void close();
+
+protected:
+    std::size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable notFull, notEmpty;
+};
+
+template <class T>
+void BoundedQueue<T>::push(T item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [&] { return items.size() < capacity; });
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+}
+
+template <class T>
+bool BoundedQueue<T>::pop(T &item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+    if (items.empty()) return false;
+    item = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+}
+
+template <class T>
+void BoundedQueue<T>::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notEmpty.notify_all();
+}
+
+/**
+ * @class OrderedPipeline
+ * @brief Solves tasks on a pool of threads and writes their results in sequence order
+ * @tparam Task Type of one unit of work, e.g. the blocks of input.txt with the same source
+ *
+ * @details Every result has a sequence number, its position in the output; a task
+ * may produce the results of any set of sequence numbers, not necessarily consecutive.
+ * At most `window` sequence numbers can be read but not yet written, which bounds
+ * memory when one task is much slower than the rest: the reader must submit tasks so
+ * that the lowest sequence number not yet submitted is always within the window,
+ * e.g. by never reordering blocks across more than `window` of them.
+ */
+template <class Task>
+class OrderedPipeline {
+public:
+    /**
+     * @param threads Number of solving workers, at least 1 is used
+     * @param window Maximum number of sequence numbers submitted but not yet written
+     * @param chunk Bytes of results gathered before they are written to the stream
+     */
+    explicit OrderedPipeline(unsigned threads, std::size_t window = 8192, std::size_t chunk = 1 << 20);
+
+    /**
+     * @brief Reads, solves and writes every task
+     * @param read void(submit): reader stage, run on the calling thread. Calls
+     * submit(Task, last) for every task, last being its highest sequence number
+     * @param solve void(const Task&, emit): solving stage, must be thread safe. Calls
+     * emit(seq, std::string) once for every sequence number of the task
+     * @param out Stream the results are written to, in sequence order, by a writer thread.
+     * Sequence numbers are expected to be 0, 1, 2, ... with no gap.
+     */
+    template <class Read, class Solve>
+    void run(Read read, Solve solve, std::ostream &out);
+
+protected:
+    unsigned threads;
+    std::size_t window;
+    std::size_t chunk;
+};
+
+template <class Task>
+OrderedPipeline<Task>::OrderedPipeline(unsigned threads, std::size_t window, std::size_t chunk)
+    : threads(threads ? threads : 1), window(window ? window : 1), chunk(chunk) {}
+
+template <class Task>
+template <class Read, class Solve>
+void OrderedPipeline<Task>::run(Read read, Solve solve, std::ostream &out) {
+    BoundedQueue<Task> tasks(2 * (std::size_t) threads);
+    BoundedQueue<std::pair<std::size_t, std::string>> results(window);
+
+    std::mutex mutex;
+    std::condition_variable space; // signalled when results are written
+    std::size_t written = 0;       // results written to out
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back([&]() {
+            Task task;
+            auto emit = [&](std::size_t seq, std::string text) { results.push({seq, std::move(text)}); };
+            while (tasks.pop(task)) solve(task, emit);
+        });
+    }
+
+    std::thread writer([&]() {
+        std::map<std::size_t, std::string> buffer;
+        std::string pending;
+        pending.reserve(chunk);
+        std::pair<std::size_t, std::string> result;
+        while (results.pop(result)) {
+            buffer.emplace(result.first, std::move(result.second));
+            std::size_t next = written;
+            for (auto it = buffer.begin(); it != buffer.end() && it->first == next; it = buffer.erase(it)) {
+                pending += it->second;
+                next++;
+                if (pending.size() >= chunk) {
+                    out.write(pending.data(), (std::streamsize) pending.size());
+                    pending.clear();
+                }
+            }
+            if (next != written) {
+                std::lock_guard<std::mutex> lock(mutex);
+                written = next;
+                space.notify_all();
+            }
+        }
+        out.write(pending.data(), (std::streamsize) pending.size());
+        out.flush();
+    });
+
+    auto submit = [&](Task task, std::size_t last) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [&] { return last < written + window; });
+        }
+        tasks.push(std::move(task));
+    };
+    read(submit);
+
+    tasks.close();
+    for (std::thread &t : pool) t.join();
+    results.close();
+    writer.join();
+}
+
+#endif /* DA_TP_CLASSES_PIPELINE */
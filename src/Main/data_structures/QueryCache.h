@@ -0,0 +1,190 @@
+/**
+ * @file QueryCache.h
+ * @brief Bounded cache of the answers of route queries
+ *
+ * @details Query logs are skewed: the same few routes are asked for over and over
+ * (the sample input already repeats 5->4 and 8->5). The text written for a query
+ * only depends on its mode, its endpoints and parameters, and its restrictions, so
+ * it can be kept and written again. Entries are evicted least recently used first,
+ * once their total size goes over a byte budget.
+ */
+
+#ifndef DA_TP_CLASSES_QUERYCACHE
+#define DA_TP_CLASSES_QUERYCACHE
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct QueryKey
+ * @brief Normalized description of a query
+ */
+struct QueryKey {
+    std::string mode;               ///< e.g. "driving", "driving-restricted", "driving-walking"
+    int source = -1;
+    int destination = -1;
+    int maxWalkTime = -1;           ///< -1 when the mode has none
+    unsigned alternatives = 0;      ///< 0 when the mode has none
+    std::vector<int> restrictions;  ///< RouteOverlay::signature()
+
+    bool operator==(const QueryKey &other) const = default;
+};
+
+/**
+ * @brief Hash of a QueryKey, restrictions included
+ */
+struct QueryKeyHash {
+    std::size_t operator()(const QueryKey &key) const {
+        uint64_t hash = std::hash<std::string>()(key.mode);
+        auto mix = [&hash](uint64_t x) { hash = (hash ^ x) * 0x100000001b3ull; hash ^= hash >> 29; };
+        mix((uint32_t) key.source);
+        mix((uint32_t) key.destination);
+        mix((uint32_t) key.maxWalkTime);
+        mix(key.alternatives);
+        for (int x : key.restrictions) mix((uint32_t) x);
+        return hash;
+    }
+};
+
+/**
+ * @class QueryCache
+ * @brief Thread safe LRU map from QueryKey to the text answering it, under a byte budget
+ */
+class QueryCache {
+public:
+    /**
+     * @brief Counters since the cache was created
+     */
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t evictions = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    /**
+     * @param budget Maximum size of the entries, in bytes; 0 disables the cache
+     */
+    explicit QueryCache(std::size_t budget) : budget(budget) {}
+
+    /**
+     * @brief Looks a query up, and marks it as the most recently used
+     * @param key The query
+     * @param value Output: its answer, when found
+     * @return true on a hit
+     */
+    bool get(const QueryKey &key, std::string &value);
+
+    /**
+     * @brief Stores the answer of a query, evicting the least recently used ones to make room
+     * @param key The query
+     * @param value Its answer; not stored if it alone is over the budget
+     */
+    void put(const QueryKey &key, std::string value);
+
+    /**
+     * @brief Changes the budget, evicting entries if it shrinks
+     */
+    void setBudget(std::size_t bytes);
+
+    /**
+     * @brief Drops every entry, e.g. when the graph the answers came from is replaced
+     * @details The hit, miss and eviction counters are kept.
+     */
+    void clear();
+
+    Stats getStats() const;
+
+protected:
+    struct Entry {
+        QueryKey key;
+        std::string value;
+        std::size_t bytes;
+    };
+
+    std::size_t budget;
+    Stats stats;
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<QueryKey, std::list<Entry>::iterator, QueryKeyHash> index;
+    mutable std::mutex mutex;
+
+    static std::size_t entryBytes(const QueryKey &key, const std::string &value);
+    void evict();
+};
+
+/**
+ * @brief Approximate memory of an entry: its key and value twice (list and index) plus node overhead
+ */
+inline std::size_t QueryCache::entryBytes(const QueryKey &key, const std::string &value) {
+    std::size_t keyBytes = sizeof(QueryKey) + key.mode.size() + key.restrictions.size() * sizeof(int);
+    return 2 * keyBytes + sizeof(Entry) + value.size() + 4 * sizeof(void *);
+}
+
+inline bool QueryCache::get(const QueryKey &key, std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        stats.misses++;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    value = it->second->value;
+    stats.hits++;
+    return true;
+}
+
+inline void QueryCache::put(const QueryKey &key, std::string value) {
+    std::size_t bytes = entryBytes(key, value);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > budget) return;
+    auto it = index.find(key);
+    if (it != index.end()) { // answered by another thread in the meantime
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+    entries.push_front({key, std::move(value), bytes});
+    index.emplace(key, entries.begin());
+    stats.entries++;
+    stats.bytes += bytes;
+    evict();
+}
+
+inline void QueryCache::setBudget(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evict();
+}
+
+inline void QueryCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    index.clear();
+    entries.clear();
+    stats.entries = 0;
+    stats.bytes = 0;
+}
+
+inline void QueryCache::evict() {
+    while (stats.bytes > budget) {
+        const Entry &last = entries.back();
+        stats.bytes -= last.bytes;
+        stats.entries--;
+        stats.evictions++;
+        index.erase(last.key);
+        entries.pop_back();
+    }
+}
+
+inline QueryCache::Stats QueryCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+#endif /* DA_TP_CLASSES_QUERYCACHE */
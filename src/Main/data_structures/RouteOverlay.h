@@ -0,0 +1,206 @@
+/**
+ * @file RouteOverlay.h
+ * @brief Per-query restrictions applied on top of an immutable CSRGraph
+ *
+ * @details AvoidNodes, AvoidSegments and IncludeNode used to be applied by
+ * changing Vertex::available and deleting edges, which forced the graph to be
+ * reloaded for every query. A RouteOverlay records them instead, as a node
+ * bitset and an edge mask that the relax functions consult, and is simply
+ * dropped when the query is answered.
+ */
+
+#ifndef DA_TP_CLASSES_ROUTEOVERLAY
+#define DA_TP_CLASSES_ROUTEOVERLAY
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "CSRGraph.h"
+
+/**
+ * @class RouteOverlay
+ * @brief Avoided vertices, avoided edges and required vertices of one query
+ *
+ * @details Vertices and edges are identified by their index in the CSRGraph.
+ * The bitsets only grow up to the highest index that was marked, so an
+ * overlay without restrictions allocates nothing.
+ */
+class RouteOverlay {
+public:
+    /**
+     * @brief Blocks a vertex (same effect as Vertex::setAvailable(-1))
+     * @param v Vertex index
+     */
+    void avoidNode(int v);
+
+    /**
+     * @brief Removes a vertex from the blocked set
+     * @param v Vertex index
+     */
+    void allowNode(int v);
+
+    /**
+     * @brief Blocks an edge (same effect as removing it from the graph)
+     * @param e Forward edge id
+     */
+    void avoidEdge(int e);
+
+    /**
+     * @brief Removes an edge from the blocked set
+     * @param e Forward edge id
+     */
+    void allowEdge(int e);
+
+    bool isNodeAvoided(int v) const;
+    bool isEdgeAvoided(int e) const;
+
+    /**
+     * @brief Checks if the overlay has no avoided vertex or edge
+     * @details Only the bits that are set count: allowNode and allowEdge leave
+     * cleared words behind. Required vertices don't count either, since each leg
+     * between them is an unrestricted shortest route (see waypoints.h).
+     */
+    bool empty() const;
+
+    /**
+     * @brief Lists the restrictions in a canonical form
+     * @return Avoided vertex indices, -1, avoided edge ids, -1, required vertex
+     * indices, each part sorted: equal for overlays that restrict routes the same way
+     */
+    std::vector<int> signature() const;
+
+    /**
+     * @brief Blocks the vertex with a given content
+     * @return false if the graph has no such vertex
+     */
+    template <class T>
+    bool avoidNode(const CSRGraph<T> &g, const T &in);
+
+    /**
+     * @brief Blocks every edge between two vertices, in both directions
+     * @details Mirrors removing the edges source->dest and dest->source
+     * @return false if one of the vertices does not exist
+     */
+    template <class T>
+    bool avoidSegment(const CSRGraph<T> &g, const T &source, const T &dest);
+
+    /**
+     * @brief Adds a vertex routes must pass through
+     * @details Like Vertex::setAvailable(1), this also unblocks the vertex.
+     * A vertex that is already required is not added twice.
+     * @return false if the graph has no such vertex
+     */
+    template <class T>
+    bool addIncludeNode(const CSRGraph<T> &g, const T &in);
+
+    /**
+     * @var std::vector<int> RouteOverlay::includeNodes
+     * @brief Indices of the vertices routes must pass through, in any order
+     */
+    std::vector<int> includeNodes;
+
+protected:
+    std::vector<uint64_t> nodeBits;
+    std::vector<uint64_t> edgeBits;
+};
+
+/**
+ * @brief Sets bit i of a growable bitset
+ */
+inline void setBit(std::vector<uint64_t> &bits, int i) {
+    if ((std::size_t) (i >> 6) >= bits.size())
+        bits.resize((i >> 6) + 1, 0);
+    bits[i >> 6] |= uint64_t(1) << (i & 63);
+}
+
+/**
+ * @brief Tests bit i of a growable bitset
+ */
+inline bool testBit(const std::vector<uint64_t> &bits, int i) {
+    return (std::size_t) (i >> 6) < bits.size() && (bits[i >> 6] >> (i & 63) & 1);
+}
+
+inline void RouteOverlay::avoidNode(int v) {
+    setBit(nodeBits, v);
+}
+
+inline void RouteOverlay::allowNode(int v) {
+    if ((std::size_t) (v >> 6) < nodeBits.size())
+        nodeBits[v >> 6] &= ~(uint64_t(1) << (v & 63));
+}
+
+inline void RouteOverlay::avoidEdge(int e) {
+    setBit(edgeBits, e);
+}
+
+inline void RouteOverlay::allowEdge(int e) {
+    if ((std::size_t) (e >> 6) < edgeBits.size())
+        edgeBits[e >> 6] &= ~(uint64_t(1) << (e & 63));
+}
+
+inline bool RouteOverlay::isNodeAvoided(int v) const {
+    return testBit(nodeBits, v);
+}
+
+inline bool RouteOverlay::isEdgeAvoided(int e) const {
+    return testBit(edgeBits, e);
+}
+
+inline bool RouteOverlay::empty() const {
+    auto clear = [](uint64_t word) { return word == 0; };
+    return std::ranges::all_of(nodeBits, clear) && std::ranges::all_of(edgeBits, clear);
+}
+
+inline std::vector<int> RouteOverlay::signature() const {
+    std::vector<int> res;
+    for (const std::vector<uint64_t> *bits : {&nodeBits, &edgeBits}) {
+        for (std::size_t w = 0; w < bits->size(); w++) {
+            for (uint64_t word = (*bits)[w]; word != 0; word &= word - 1)
+                res.push_back((int) (w * 64 + std::countr_zero(word)));
+        }
+        res.push_back(-1);
+    }
+    std::size_t included = res.size();
+    res.insert(res.end(), includeNodes.begin(), includeNodes.end());
+    std::sort(res.begin() + included, res.end());
+    return res;
+}
+
+template <class T>
+bool RouteOverlay::avoidNode(const CSRGraph<T> &g, const T &in) {
+    int v = g.findIdx(in);
+    if (v == -1)
+        return false;
+    avoidNode(v);
+    return true;
+}
+
+template <class T>
+bool RouteOverlay::avoidSegment(const CSRGraph<T> &g, const T &source, const T &dest) {
+    int u = g.findIdx(source);
+    int v = g.findIdx(dest);
+    if (u == -1 || v == -1)
+        return false;
+    for (int e = g.outBegin(u); e < g.outEnd(u); e++)
+        if (g.getDest(e) == v)
+            avoidEdge(e);
+    for (int e = g.outBegin(v); e < g.outEnd(v); e++)
+        if (g.getDest(e) == u)
+            avoidEdge(e);
+    return true;
+}
+
+template <class T>
+bool RouteOverlay::addIncludeNode(const CSRGraph<T> &g, const T &in) {
+    int v = g.findIdx(in);
+    if (v == -1)
+        return false;
+    allowNode(v);
+    if (std::find(includeNodes.begin(), includeNodes.end(), v) == includeNodes.end())
+        includeNodes.push_back(v);
+    return true;
+}
+
+#endif /* DA_TP_CLASSES_ROUTEOVERLAY */
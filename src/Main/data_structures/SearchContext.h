@@ -0,0 +1,185 @@
+/**
+ * @file SearchContext.h
+ * @brief Labels of a shortest path search, kept outside of the graph
+ *
+ * @details Searches used to write dist/path (and the heap index) into every Vertex,
+ * so two searches could not share a graph and each one began with an O(V) reset.
+ * A SearchContext owns those labels in dense arrays indexed by vertex. Every label
+ * carries the epoch of the search that wrote it, and starting a new search just
+ * increments the epoch: labels of older searches read as "unset".
+ * The heap of the search is a template policy (see IndexPriorityQueues.h).
+ */
+
+#ifndef DA_TP_CLASSES_SEARCHCONTEXT
+#define DA_TP_CLASSES_SEARCHCONTEXT
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "IndexPriorityQueues.h"
+
+/**
+ * @brief Distance of a vertex that was not reached
+ */
+#define INF_DIST INT_MAX
+
+/**
+ * @class BasicSearchContext
+ * @brief Reusable distance, path, key and mark labels of one search
+ * @tparam Queue Priority queue over vertex indices, ordered by the key labels
+ *
+ * @details Distances are whole minutes, as in the input files. Unset labels read as
+ * INF_DIST (dist and key), -1 (path) and 0 (mark). The context also owns the heap
+ * of the search, ordered by key, so reusing it allocates nothing once it has seen
+ * the largest graph. Not copyable: the heap refers to the key array.
+ */
+template <class Queue>
+class BasicSearchContext {
+public:
+    BasicSearchContext();
+    BasicSearchContext(const BasicSearchContext &) = delete;
+    BasicSearchContext &operator=(const BasicSearchContext &) = delete;
+
+    /**
+     * @brief Starts a new search over vertices 0 .. n-1
+     * @param n Number of vertices of the graph
+     *
+     * @details O(1), except when the arrays have to grow or the epoch counter wraps.
+     */
+    void reset(int n);
+
+    int getDist(int v) const;
+    int getPath(int v) const;
+    int getKey(int v) const;
+    int getMark(int v) const;
+
+    /**
+     * @brief Sets the distance of a vertex, and its key to the same value
+     * @details Searches ordered by something else than the distance (A*) set the key afterwards.
+     */
+    void setDist(int v, int dist);
+    void setPath(int v, int edge);
+    void setKey(int v, int key);
+    void setMark(int v, int mark);
+
+    /**
+     * @brief Gets the heap of the search, ordered by key
+     */
+    Queue &getQueue();
+
+protected:
+    void touch(int v);
+
+    std::vector<int> dist;
+    std::vector<int> path;   // edge id each vertex was reached through
+    std::vector<int> key;
+    std::vector<int> mark;   // free for the algorithm, e.g. targets still to settle
+    std::vector<uint32_t> stamp;
+    uint32_t epoch = 0;
+    Queue queue;
+};
+
+/**
+ * @brief Context of the default searches, on a binary heap
+ *
+ * @details The binary heap extracts equal keys in the same order as the original
+ * Vertex based searches, so it is the one that keeps the routes of the sample output.
+ */
+typedef BasicSearchContext<MutableIndexPriorityQueue<int>> SearchContext;
+
+template <class Queue>
+BasicSearchContext<Queue>::BasicSearchContext() : queue(key) {}
+
+template <class Queue>
+void BasicSearchContext<Queue>::reset(int n) {
+    if ((int) stamp.size() < n) {
+        dist.resize(n);
+        path.resize(n);
+        key.resize(n);
+        mark.resize(n);
+        stamp.resize(n, 0);
+    }
+    if (++epoch == 0) { // wrapped: labels from 2^32 searches ago would look current
+        std::fill(stamp.begin(), stamp.end(), 0);
+        epoch = 1;
+    }
+    queue.reset(n);
+}
+
+template <class Queue>
+void BasicSearchContext<Queue>::touch(int v) {
+    if (stamp[v] != epoch) {
+        stamp[v] = epoch;
+        dist[v] = INF_DIST;
+        path[v] = -1;
+        key[v] = INF_DIST;
+        mark[v] = 0;
+    }
+}
+
+template <class Queue>
+int BasicSearchContext<Queue>::getDist(int v) const {
+    return stamp[v] == epoch ? dist[v] : INF_DIST;
+}
+
+template <class Queue>
+int BasicSearchContext<Queue>::getPath(int v) const {
+    return stamp[v] == epoch ? path[v] : -1;
+}
+
+template <class Queue>
+int BasicSearchContext<Queue>::getKey(int v) const {
+    return stamp[v] == epoch ? key[v] : INF_DIST;
+}
+
+template <class Queue>
+int BasicSearchContext<Queue>::getMark(int v) const {
+    return stamp[v] == epoch ? mark[v] : 0;
+}
+
+template <class Queue>
+void BasicSearchContext<Queue>::setDist(int v, int dist) {
+    touch(v);
+    this->dist[v] = dist;
+    key[v] = dist;
+}
+
+template <class Queue>
+void BasicSearchContext<Queue>::setPath(int v, int edge) {
+    touch(v);
+    path[v] = edge;
+}
+
+template <class Queue>
+void BasicSearchContext<Queue>::setKey(int v, int key) {
+    touch(v);
+    this->key[v] = key;
+}
+
+template <class Queue>
+void BasicSearchContext<Queue>::setMark(int v, int mark) {
+    touch(v);
+    this->mark[v] = mark;
+}
+
+template <class Queue>
+Queue &BasicSearchContext<Queue>::getQueue() {
+    return queue;
+}
+
+/**
+ * @brief Gets a context owned by the calling thread
+ * @param slot Index of the context, for callers that need several results at once
+ * @return The same context for the same thread and slot, reused across queries
+ */
+template <class Queue = MutableIndexPriorityQueue<int>>
+BasicSearchContext<Queue> &threadContext(unsigned slot = 0) {
+    thread_local std::deque<BasicSearchContext<Queue>> contexts;
+    while (contexts.size() <= slot) contexts.emplace_back();
+    return contexts[slot];
+}
+
+#endif /* DA_TP_CLASSES_SEARCHCONTEXT */
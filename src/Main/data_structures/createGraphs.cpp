@@ -3,14 +3,20 @@
  * @brief Implementation of graph creation and manipulation functions
  */
 
+#include <climits>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
 
 using namespace std;
 
 #include "./createGraphs.h"
+#include "./csvLoader.h"
+#include "./graphSnapshot.h"
 
 void populateGraphs(Graph<int> *g, string filename);
 void populateEdges(Graph<int> *g, string filename);
@@ -23,33 +29,14 @@ void populateEdges(Graph<int> *g, string filename);
  * @param g The graph to search for isolated nodes
  * @return vector<int> A vector containing the IDs of all isolated nodes
  */
-vector<int> createGraphs::findIsolatedNodesInGraph(Graph<int> g) {
-    int i, id;
+vector<int> createGraphs::findIsolatedNodesInGraph(const Graph<int> &g) {
     vector<int> res;
-    vector<int> rem;
 
-    for (auto v: g.getVertexSet()) {
-        if (v->getAdj().empty()) {
+    for (auto v: g.vertices()) {
+        if (v->outEdges().empty() && v->inEdges().empty()) {
             res.push_back(v->getInfo());
         }
     }
-
-    for (auto v: g.getVertexSet()) {
-        for (auto &e: v->getAdj()) {
-            auto w = e->getDest();
-            auto it = std::find(res.begin(), res.end(), w->getInfo());
-            if (it != res.end()) {
-                rem.push_back(w->getInfo());
-            }
-        }
-    }
-
-    for (i = 0; i < rem.size(); i++) {
-        id = rem[i];
-        auto it = std::find(res.begin(), res.end(), id);
-        if (it != res.end())
-            res.erase(it);
-    }
     return res;
 }
 
@@ -80,35 +67,22 @@ Graph<int> createGraphs::graphFromFile(string folder) {
  *
  * @param g Pointer to the graph to populate
  * @param filename Path to the CSV file containing vertex data
+ *
+ * @details The file is memory-mapped and parsed in parallel by csvLoader;
+ * vertices are then added in file order.
  */
 void populateGraphs(Graph<int> *g, string filename) {
-    ifstream file;
-    file.open(filename);
-    if (!file.is_open()) {
+    MappedFile file(filename, MappedFile::Access::Sequential);
+    if (!file.isOpen()) {
         cerr << "Error: Could not open file " << filename << endl;
         return;
     }
 
-    string line;
-    getline(file, line);
-    while (getline(file, line)) {
-        istringstream iss(line);
-        string location, id_str, code, parking_str;
-        if (getline(iss, location, ',') &&
-            getline(iss, id_str, ',') &&
-            getline(iss, code, ',') &&
-            getline(iss, parking_str, ',')) {
-            int id = stoi(id_str);
-            int parking = stoi(parking_str);
-            g->addVertex(id);
-            g->findVertex(id)->setLocation(location);
-            g->findVertex(id)->setCode(code);
-            g->findVertex(id)->setParking(parking);
-        }
-
+    vector<LocationRow> rows = csvLoader::parseLocations(file);
+    g->reserve(g->getNumVertex() + rows.size());
+    for (const LocationRow &row : rows) {
+        g->addVertex(row.id, string(row.location), string(row.code), row.parking);
     }
-
-    file.close();
 }
 
 /**
@@ -118,33 +92,28 @@ void populateGraphs(Graph<int> *g, string filename) {
  *
  * @param g Pointer to the graph to populate
  * @param filename Path to the CSV file containing edge data
+ *
+ * @details The file is memory-mapped and parsed in parallel by csvLoader.
+ * A time of X means the edge cannot be used with that mode and is stored as -1.
  */
 void populateEdges(Graph<int> *g, string filename) {
-    ifstream file;
-    file.open(filename);
-    if (!file.is_open()) {
+    MappedFile file(filename, MappedFile::Access::Sequential);
+    if (!file.isOpen()) {
         cerr << "Error: Could not open file " << filename << endl;
         return;
     }
 
-    string line;
-    getline(file, line);
-    while (getline(file, line)) {
-        istringstream iss(line);
-        string location1, location2, Driving, Walking;
-        if (getline(iss, location1, ',') &&
-            getline(iss, location2, ',') &&
-            getline(iss, Driving, ',') &&
-            getline(iss, Walking, ',')) {
-                int driving = (Driving == "X") ? -1 : stoi(Driving);
-                int walking = (Walking == "X") ? -1 : stoi(Walking);
-
-                g->addBidirectionalEdge(g->findCode(location1)->getInfo(), g->findCode(location2)->getInfo(),
-                    driving, walking);
-            }
+    vector<DistanceRow> rows = csvLoader::parseDistances(file);
+    g->reserve(g->getNumVertex(), 2 * rows.size());
+    for (const DistanceRow &row : rows) {
+        Vertex<int> *v1 = g->findCode(row.code1);
+        Vertex<int> *v2 = g->findCode(row.code2);
+        if (v1 == nullptr || v2 == nullptr) {
+            cerr << "Error: Unknown location in " << filename << ": " << row.code1 << "," << row.code2 << endl;
+            continue;
+        }
+        g->addBidirectionalEdge(v1->getInfo(), v2->getInfo(), row.driving, row.walking);
     }
-
-    file.close();
 }
 // ------------------------------------------------------------
 //
@@ -159,7 +128,7 @@ void populateEdges(Graph<int> *g, string filename) {
  * @param gname The name to use for the output file
  * @param g The graph to process
  */
-void createGraphs::emitDOTFile(string gname, Graph<int> g) {
+void createGraphs::emitDOTFile(string gname, const Graph<int> &g) {
     ofstream g_dot_file;
     int idx;
     vector<int> rem;
@@ -177,13 +146,13 @@ void createGraphs::emitDOTFile(string gname, Graph<int> g) {
 
     rem = findIsolatedNodesInGraph(g);
 
-    for (auto v: g.getVertexSet()) {
+    for (auto v: g.vertices()) {
         idx = v->getInfo();
         auto it = std::find(rem.begin(), rem.end(), idx);
         if (it != rem.end()) {
             g_dot_file << "  " << idx << " -> " << idx << " [color = \"white\"];\n";
         } else {
-            for (auto &e: v->getAdj()) {
+            for (auto &e: v->outEdges()) {
                 auto w = e->getDest();
                 g_dot_file << "  " << v->getInfo() << " -> " << w->getInfo() << ";";
                 g_dot_file << "\n";
@@ -197,3 +166,252 @@ void createGraphs::emitDOTFile(string gname, Graph<int> g) {
 
 
 // ------------------------------------------------------------
+
+/**
+ * @brief Rounds a file position up to the alignment of the snapshot sections
+ */
+static uint64_t alignSection(uint64_t pos) {
+    return (pos + snapshotAlignment - 1) / snapshotAlignment * snapshotAlignment;
+}
+
+/**
+ * @brief Writes a graph snapshot in the binary format of graphSnapshot.h
+ *
+ * The file is written next to its final name and then renamed, so a process
+ * mapping the previous snapshot keeps a consistent view.
+ *
+ * @param g The graph to write
+ * @param fileName Path of the snapshot file
+ * @return true if the file was written
+ */
+bool createGraphs::writeSnapshot(const CSRGraph<int> &g, string fileName) {
+    const CSRArrays<int> &a = g.getArrays();
+    struct Blob {
+        const void *data;
+        uint64_t size;
+    };
+    Blob blobs[SectionCount] = {
+        {a.info.data(), a.info.size_bytes()},
+        {a.codeOffsets.data(), a.codeOffsets.size_bytes()},
+        {a.codeChars.data(), a.codeChars.size_bytes()},
+        {a.parking.data(), a.parking.size_bytes()},
+        {a.offsets.data(), a.offsets.size_bytes()},
+        {a.origins.data(), a.origins.size_bytes()},
+        {a.targets.data(), a.targets.size_bytes()},
+        {a.driving.data(), a.driving.size_bytes()},
+        {a.walking.data(), a.walking.size_bytes()},
+        {a.inOffsets.data(), a.inOffsets.size_bytes()},
+        {a.inEdges.data(), a.inEdges.size_bytes()},
+        {a.denseIdx.data(), a.denseIdx.size_bytes()},
+        {a.sortedInfo.data(), a.sortedInfo.size_bytes()},
+        {a.sortedIdx.data(), a.sortedIdx.size_bytes()},
+    };
+
+    SnapshotHeader header{};
+    memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.byteOrder = snapshotByteOrder;
+    header.idSize = sizeof(int);
+    header.sectionCount = SectionCount;
+    header.numVertex = g.getNumVertex();
+    header.numEdges = g.getNumEdges();
+    uint64_t pos = alignSection(sizeof(header));
+    for (uint32_t i = 0; i < SectionCount; i++) {
+        header.sections[i] = {pos, blobs[i].size};
+        pos = alignSection(pos + blobs[i].size);
+    }
+
+    string tmpName = temporaryFileName(fileName);
+    if (tmpName.empty()) {
+        cerr << "Error: Could not create a temporary file next to " << fileName << endl;
+        return false;
+    }
+    error_code ec;
+    ofstream file(tmpName, ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open file " << tmpName << endl;
+        filesystem::remove(tmpName, ec);
+        return false;
+    }
+    const char padding[snapshotAlignment] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (uint32_t i = 0; i < SectionCount; i++) {
+        file.write(padding, header.sections[i].offset - written);
+        if (blobs[i].size > 0) {
+            file.write(static_cast<const char *>(blobs[i].data), blobs[i].size);
+        }
+        written = header.sections[i].offset + blobs[i].size;
+    }
+    file.close();
+    if (!file) {
+        cerr << "Error: Could not write file " << tmpName << endl;
+        filesystem::remove(tmpName, ec);
+        return false;
+    }
+
+    filesystem::rename(tmpName, fileName, ec);
+    if (ec) {
+        cerr << "Error: Could not write file " << fileName << endl;
+        filesystem::remove(tmpName, ec);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the span of a snapshot section, checking it against the file
+ * @param file The mapped snapshot
+ * @param section The section of the header
+ * @param count Expected number of elements, or -1 if any number is valid
+ * @param out Output: view of the section
+ * @return true if the section lies inside the file and has the expected size
+ */
+template <class U>
+static bool sectionSpan(const MappedFile &file, const SnapshotSection &section, int64_t count, span<const U> &out) {
+    if (section.offset % alignof(U) != 0 || section.size % sizeof(U) != 0 ||
+        section.offset > file.size() || section.size > file.size() - section.offset) {
+        return false;
+    }
+    if (count != -1 && section.size != count * sizeof(U)) {
+        return false;
+    }
+    out = span<const U>(reinterpret_cast<const U *>(file.data() + section.offset), section.size / sizeof(U));
+    return true;
+}
+
+/**
+ * @brief Checks that an offsets array starts at 0, never decreases and ends at end
+ */
+static bool validOffsets(span<const int> offsets, int64_t end) {
+    if (offsets.empty() || offsets[0] != 0 || offsets.back() != end) {
+        return false;
+    }
+    for (size_t i = 1; i < offsets.size(); i++) {
+        if (offsets[i] < offsets[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks every index stored in the arrays of a snapshot, in O(n + m)
+ *
+ * The searches use these indices without bounds checks, so a corrupted file
+ * must be rejected before any of them runs.
+ *
+ * @param a The arrays, with the sizes of the header already checked
+ * @param n Number of vertices
+ * @param m Number of edges
+ * @return true if every offset, vertex index, edge id and weight is in range
+ */
+static bool validArrays(const CSRArrays<int> &a, int64_t n, int64_t m) {
+    if (!validOffsets(a.codeOffsets, (int64_t) a.codeChars.size()) || !validOffsets(a.offsets, m) ||
+        !validOffsets(a.inOffsets, m)) {
+        return false;
+    }
+    for (int64_t v = 0; v < n; v++) {
+        for (int e = a.offsets[v]; e < a.offsets[v + 1]; e++) {
+            if (a.origins[e] != v || a.targets[e] < 0 || a.targets[e] >= n || a.driving[e] < -1 || a.walking[e] < -1) {
+                return false;
+            }
+        }
+        for (int r = a.inOffsets[v]; r < a.inOffsets[v + 1]; r++) {
+            if (a.inEdges[r] < 0 || a.inEdges[r] >= m || a.targets[a.inEdges[r]] != v) {
+                return false;
+            }
+        }
+    }
+    for (int v : a.denseIdx) {
+        if (v < -1 || v >= n) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.sortedIdx.size(); i++) {
+        if (a.sortedIdx[i] < 0 || a.sortedIdx[i] >= n || (i > 0 && a.sortedInfo[i] < a.sortedInfo[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Loads a graph snapshot by memory-mapping it
+ *
+ * The arrays are used in place, without per-element deserialization; they are
+ * only read once, to check that every index they hold is in range (validArrays).
+ *
+ * @param fileName Path of the snapshot file
+ * @return The graph, whose arrays point into the mapping, or nothing if the
+ * file is missing, truncated, corrupted or of another format version
+ */
+optional<CSRGraph<int>> createGraphs::loadSnapshot(string fileName) {
+    auto file = make_shared<MappedFile>(fileName);
+    if (!file->isOpen() || file->size() < sizeof(SnapshotHeader)) {
+        return nullopt;
+    }
+    SnapshotHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 || header.version != snapshotVersion ||
+        header.byteOrder != snapshotByteOrder || header.idSize != sizeof(int) || header.sectionCount != SectionCount) {
+        return nullopt;
+    }
+
+    if (header.numVertex > INT_MAX || header.numEdges > INT_MAX) {
+        return nullopt;
+    }
+    int64_t n = header.numVertex;
+    int64_t m = header.numEdges;
+    const SnapshotSection *s = header.sections;
+    CSRArrays<int> a;
+    bool ok = sectionSpan(*file, s[SectionInfo], n, a.info) &&
+              sectionSpan(*file, s[SectionCodeOffsets], n + 1, a.codeOffsets) &&
+              sectionSpan(*file, s[SectionCodeChars], -1, a.codeChars) &&
+              sectionSpan(*file, s[SectionParking], n, a.parking) &&
+              sectionSpan(*file, s[SectionOffsets], n + 1, a.offsets) &&
+              sectionSpan(*file, s[SectionOrigins], m, a.origins) &&
+              sectionSpan(*file, s[SectionTargets], m, a.targets) &&
+              sectionSpan(*file, s[SectionDriving], m, a.driving) &&
+              sectionSpan(*file, s[SectionWalking], m, a.walking) &&
+              sectionSpan(*file, s[SectionInOffsets], n + 1, a.inOffsets) &&
+              sectionSpan(*file, s[SectionInEdges], m, a.inEdges) &&
+              sectionSpan(*file, s[SectionDenseIdx], -1, a.denseIdx) &&
+              sectionSpan(*file, s[SectionSortedInfo], -1, a.sortedInfo) &&
+              sectionSpan(*file, s[SectionSortedIdx], a.sortedInfo.size(), a.sortedIdx);
+    if (!ok || !validArrays(a, n, m)) {
+        return nullopt;
+    }
+    return CSRGraph<int>(a, file);
+}
+
+/**
+ * @brief Loads the graph of a data folder, going through its snapshot
+ *
+ * Maps folder/graph.bin when it is newer than Locations.csv and Distances.csv;
+ * otherwise parses the CSV files and (re)writes the snapshot for the next run.
+ *
+ * @param folder Path to the folder containing the data files
+ * @return CSRGraph<int> The graph
+ */
+CSRGraph<int> createGraphs::snapshotFromFolder(string folder) {
+    string snapshot = folder + "/graph.bin";
+    error_code ec1, ec2, ec3;
+    auto snapshotTime = filesystem::last_write_time(snapshot, ec1);
+    auto locationsTime = filesystem::last_write_time(folder + "/Locations.csv", ec2);
+    auto distancesTime = filesystem::last_write_time(folder + "/Distances.csv", ec3);
+    if (!ec1 && (ec2 || snapshotTime >= locationsTime) && (ec3 || snapshotTime >= distancesTime)) {
+        if (auto g = loadSnapshot(snapshot)) {
+            return *g;
+        }
+    }
+
+    Graph<int> graph = graphFromFile(folder);
+    CSRGraph<int> g(graph);
+    if (writeSnapshot(g, snapshot)) {
+        if (auto mapped = loadSnapshot(snapshot)) {
+            return *mapped;
+        }
+    }
+    return g;
+}
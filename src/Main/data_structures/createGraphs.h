@@ -6,7 +6,10 @@
 #ifndef SRC_CREATE_GRAPHS_H
 #define SRC_CREATE_GRAPHS_H
 
+#include <optional>
+
 #include "Graph.h"
+#include "CSRGraph.h"
 
 using namespace std;
 
@@ -33,14 +36,40 @@ public:
      * @param g The graph to analyze
      * @return vector<int> List of IDs of isolated nodes
      */
-    static vector<int> findIsolatedNodesInGraph(Graph<int> g);
+    static vector<int> findIsolatedNodesInGraph(const Graph<int> &g);
 
     /**
      * @brief Generates a file representing the graph structure
      * @param fname The name to use for the output file
      * @param g The graph to process
      */
-    static void emitDOTFile(string fname, Graph<int> g);
+    static void emitDOTFile(string fname, const Graph<int> &g);
+
+    /**
+     * @brief Writes a graph snapshot in the binary format of graphSnapshot.h
+     * @param g The graph to write
+     * @param fileName Path of the snapshot file (replaced atomically)
+     * @return true if the file was written
+     */
+    static bool writeSnapshot(const CSRGraph<int> &g, string fileName);
+
+    /**
+     * @brief Loads a graph snapshot by memory-mapping it
+     * @param fileName Path of the snapshot file
+     * @return The graph, whose arrays point into the mapping, or nothing if the
+     * file is missing, truncated or of another format version
+     */
+    static optional<CSRGraph<int>> loadSnapshot(string fileName);
+
+    /**
+     * @brief Loads the graph of a data folder, going through its snapshot
+     * @param folder Path to the folder containing the data files
+     * @return CSRGraph<int> The graph
+     *
+     * @details Maps folder/graph.bin when it is newer than Locations.csv and
+     * Distances.csv; otherwise parses the CSV files and (re)writes the snapshot.
+     */
+    static CSRGraph<int> snapshotFromFolder(string folder);
 };
 
 #endif
@@ -0,0 +1,219 @@
+/**
+* @file csvLoader.cpp
+ * @brief Implementation of the memory-mapped, multi-threaded CSV parser
+ */
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "./csvLoader.h"
+
+/**
+ * @brief Minimum number of bytes per chunk before another thread is used
+ */
+static constexpr std::size_t minChunkBytes = 1 << 20;
+
+static constexpr uint64_t lowBytes = 0x0101010101010101ULL;
+static constexpr uint64_t highBits = 0x8080808080808080ULL;
+
+/**
+ * @brief Marks the bytes of a word equal to c
+ * @return A word whose lowest set bit is the high bit of the first byte equal to c
+ *
+ * @details Bytes after the first match may be falsely marked by the borrow of the
+ * subtraction, so only the lowest set bit is meaningful.
+ */
+static inline uint64_t matchByte(uint64_t word, char c) {
+    uint64_t x = word ^ (lowBytes * static_cast<unsigned char>(c));
+    return (x - lowBytes) & ~x & highBits;
+}
+
+/**
+ * @brief Finds the first ',' or '\n' in [p, end), eight bytes at a time
+ * @return Position of the delimiter, or end if there is none
+ */
+static const char *findDelimiter(const char *p, const char *end) {
+    if constexpr (std::endian::native == std::endian::little) {
+        while (end - p >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            uint64_t match = matchByte(word, ',') | matchByte(word, '\n');
+            if (match != 0) {
+                return p + (std::countr_zero(match) >> 3);
+            }
+            p += 8;
+        }
+    }
+    while (p < end && *p != ',' && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Splits the line starting at p into (at most) four fields
+ * @param p Start of the line
+ * @param end End of the chunk
+ * @param fields Output: the fields, without a trailing '\r'
+ * @param count Output: number of fields found (at most 4)
+ * @return Start of the next line
+ */
+static const char *splitLine(const char *p, const char *end, std::string_view *fields, int &count) {
+    count = 0;
+    while (true) {
+        const char *d = findDelimiter(p, end);
+        if (count < 4) {
+            std::string_view field(p, d - p);
+            if (!field.empty() && field.back() == '\r') {
+                field.remove_suffix(1);
+            }
+            fields[count++] = field;
+        }
+        if (d == end) {
+            return end;
+        }
+        if (*d == '\n') {
+            return d + 1;
+        }
+        p = d + 1;
+    }
+}
+
+/**
+ * @brief Converts a field to an integer, accepting leading blanks like stoi
+ * @return true if the field starts with a number
+ */
+static bool parseInt(std::string_view field, int &value) {
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+        field.remove_prefix(1);
+    }
+    auto res = std::from_chars(field.data(), field.data() + field.size(), value);
+    return res.ec == std::errc();
+}
+
+/**
+ * @brief Converts a time field, where X means the edge does not exist
+ * @return true if the field is X or a number (X is stored as -1)
+ */
+static bool parseTime(std::string_view field, int &value) {
+    if (field == "X") {
+        value = -1;
+        return true;
+    }
+    return parseInt(field, value);
+}
+
+/**
+ * @brief Parses the rows of a file (header excluded) in parallel, keeping file order
+ * @tparam Row Type of the parsed rows
+ * @tparam Parser Callable bool(const std::string_view fields[4], Row &row)
+ * @param file The mapped file
+ * @param threads Maximum number of threads (0 = hardware concurrency)
+ * @param parser Converts the fields of one line into a row
+ * @return The parsed rows
+ *
+ * @details The body is cut into roughly equal chunks, each moved forward to the
+ * next line start, so every line is parsed by exactly one thread.
+ */
+template <class Row, class Parser>
+static std::vector<Row> parseRows(const MappedFile &file, unsigned threads, Parser parser) {
+    std::vector<Row> rows;
+    if (!file.isOpen() || file.size() == 0) {
+        return rows;
+    }
+    const char *end = file.data() + file.size();
+    const char *body = static_cast<const char *>(std::memchr(file.data(), '\n', file.size()));
+    if (body == nullptr) {
+        return rows; // header only
+    }
+    body++;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t bytes = end - body;
+    unsigned parts = std::max<std::size_t>(1, std::min<std::size_t>(threads, bytes / minChunkBytes));
+
+    std::vector<const char *> bounds(parts + 1, end);
+    bounds[0] = body;
+    for (unsigned i = 1; i < parts; i++) {
+        const char *p = std::max(bounds[i - 1], body + bytes / parts * i);
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        bounds[i] = (nl == nullptr) ? end : nl + 1;
+    }
+
+    std::vector<std::vector<Row>> chunkRows(parts);
+    auto work = [&](unsigned i) {
+        std::vector<Row> &out = chunkRows[i];
+        out.reserve((bounds[i + 1] - bounds[i]) / 24);
+        std::string_view fields[4];
+        int count;
+        const char *p = bounds[i];
+        while (p < bounds[i + 1]) {
+            p = splitLine(p, bounds[i + 1], fields, count);
+            Row row;
+            if (count == 4 && parser(fields, row)) {
+                out.push_back(row);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < parts; i++) {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for (auto &t : workers) {
+        t.join();
+    }
+
+    std::size_t total = 0;
+    for (auto &c : chunkRows) {
+        total += c.size();
+    }
+    rows.reserve(total);
+    for (auto &c : chunkRows) {
+        rows.insert(rows.end(), c.begin(), c.end());
+    }
+    return rows;
+}
+
+/**
+ * @brief Parses a mapped Locations.csv (location,id,code,parking)
+ * @param file The mapped file
+ * @param threads Maximum number of threads (0 = hardware concurrency)
+ * @return The rows of the file, in order
+ */
+std::vector<LocationRow> csvLoader::parseLocations(const MappedFile &file, unsigned threads) {
+    return parseRows<LocationRow>(file, threads, [](const std::string_view *f, LocationRow &row) {
+        int parking;
+        if (!parseInt(f[1], row.id) || !parseInt(f[3], parking)) {
+            return false;
+        }
+        row.location = f[0];
+        row.code = f[2];
+        row.parking = parking != 0;
+        return true;
+    });
+}
+
+/**
+ * @brief Parses a mapped Distances.csv (location1,location2,driving,walking)
+ * @param file The mapped file
+ * @param threads Maximum number of threads (0 = hardware concurrency)
+ * @return The rows of the file, in order
+ */
+std::vector<DistanceRow> csvLoader::parseDistances(const MappedFile &file, unsigned threads) {
+    return parseRows<DistanceRow>(file, threads, [](const std::string_view *f, DistanceRow &row) {
+        if (!parseTime(f[2], row.driving) || !parseTime(f[3], row.walking)) {
+            return false;
+        }
+        row.code1 = f[0];
+        row.code2 = f[1];
+        return true;
+    });
+}
@@ -0,0 +1,69 @@
+/**
+* @file csvLoader.h
+ * @brief Zero-copy, multi-threaded parser for Locations.csv and Distances.csv
+ *
+ * @details The files are memory-mapped and split into line-aligned chunks that are
+ * parsed in parallel. Fields are located with a SWAR (SIMD within a register)
+ * delimiter scanner and numbers are converted with std::from_chars, so the only
+ * allocations are the row vectors themselves: text fields are string_views into
+ * the mapping and stay valid while the MappedFile is alive.
+ */
+
+#ifndef SRC_CSV_LOADER_H
+#define SRC_CSV_LOADER_H
+
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+/**
+ * @brief One row of Locations.csv (location,id,code,parking)
+ */
+struct LocationRow {
+    std::string_view location;
+    int id;
+    std::string_view code;
+    bool parking;
+};
+
+/**
+ * @brief One row of Distances.csv (location1,location2,driving,walking)
+ * @details A driving or walking time of X (no such edge) is stored as -1.
+ */
+struct DistanceRow {
+    std::string_view code1;
+    std::string_view code2;
+    int driving;
+    int walking;
+};
+
+/**
+ * @class csvLoader
+ * @brief Provides static methods to parse the graph CSV files
+ *
+ * @details In both files the first line is a header and is skipped, fields are
+ * separated by ',' and lines may end in "\n" or "\r\n". Rows with fewer than
+ * four fields or with malformed numbers are ignored. Rows are returned in file
+ * order whatever the number of threads.
+ */
+class csvLoader {
+public:
+    /**
+     * @brief Parses a mapped Locations.csv
+     * @param file The mapped file
+     * @param threads Maximum number of threads (0 = hardware concurrency)
+     * @return The rows of the file, in order
+     */
+    static std::vector<LocationRow> parseLocations(const MappedFile &file, unsigned threads = 0);
+
+    /**
+     * @brief Parses a mapped Distances.csv
+     * @param file The mapped file
+     * @param threads Maximum number of threads (0 = hardware concurrency)
+     * @return The rows of the file, in order
+     */
+    static std::vector<DistanceRow> parseDistances(const MappedFile &file, unsigned threads = 0);
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+* @file graphSnapshot.h
+ * @brief Versioned binary on-disk format of a CSRGraph<int>
+ *
+ * @details A snapshot is written once from the CSV inputs and then memory-mapped:
+ * every array of CSRArrays is stored as a raw, 64-byte aligned section that the
+ * routing code reads in place, so loading costs one mmap instead of parsing
+ * Locations.csv and Distances.csv, and several processes mapping the same file
+ * share its physical pages.
+ *
+ * Layout: a SnapshotHeader, followed by the sections listed in its table.
+ * Integers are stored in the byte order of the machine that wrote the file; a
+ * file with another byte order, version or id size is rejected.
+ */
+
+#ifndef SRC_GRAPH_SNAPSHOT_H
+#define SRC_GRAPH_SNAPSHOT_H
+
+#include <cstdint>
+
+/**
+ * @brief Magic bytes at the start of every snapshot
+ */
+inline constexpr char snapshotMagic[8] = {'D', 'A', 'G', 'R', 'A', 'P', 'H', '\0'};
+
+/**
+ * @brief Current version of the format, bumped on any layout change
+ */
+inline constexpr uint32_t snapshotVersion = 1;
+
+/**
+ * @brief Written as a native integer to detect files of another byte order
+ */
+inline constexpr uint32_t snapshotByteOrder = 0x01020304;
+
+/**
+ * @brief Alignment of every section, relative to the start of the file
+ */
+inline constexpr uint64_t snapshotAlignment = 64;
+
+/**
+ * @enum SnapshotSectionId
+ * @brief Sections of a snapshot, one per array of CSRArrays<int>
+ */
+enum SnapshotSectionId : uint32_t {
+    SectionInfo,
+    SectionCodeOffsets,
+    SectionCodeChars,
+    SectionParking,
+    SectionOffsets,
+    SectionOrigins,
+    SectionTargets,
+    SectionDriving,
+    SectionWalking,
+    SectionInOffsets,
+    SectionInEdges,
+    SectionDenseIdx,
+    SectionSortedInfo,
+    SectionSortedIdx,
+    SectionCount
+};
+
+/**
+ * @struct SnapshotSection
+ * @brief Position of a section in the file, in bytes
+ */
+struct SnapshotSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+/**
+ * @struct SnapshotHeader
+ * @brief First bytes of a snapshot file
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t idSize;        // sizeof(int) of the writer
+    uint32_t sectionCount;  // SectionCount of the writer
+    uint64_t numVertex;
+    uint64_t numEdges;
+    SnapshotSection sections[SectionCount];
+};
+
+#endif
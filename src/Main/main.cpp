@@ -5,36 +5,65 @@
  *
  * @details This file implements the command-line interface and core functionality
  * for the route planning system, including driving, restricted driving, and
- * combined driving-walking modes.
+ * combined driving-walking modes, and many-to-many tables of times.
  */
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <climits>
+#include <csignal>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <stdint.h>
 
 #include "data_structures/createGraphs.h"
 #include "data_structures/Graph.h"
+#include "data_structures/CSRGraph.h"
+#include "data_structures/RouteOverlay.h"
+#include "data_structures/Pipeline.h"
+#include "data_structures/BlockServer.h"
+#include "data_structures/QueryCache.h"
 #include "Modes/driving.h"
+#include "Modes/engine.h"
+#include "Modes/kshortest.h"
+#include "Modes/waypoints.h"
+#include "Modes/table.h"
+#include "Modes/sourcetree.h"
 
-void CommandLine(Graph<int> &g);
+void CommandLine(const CSRGraph<int> &g);
 void BatchModeLine();
-void processModeBlock(const vector<string>& blockLines, const string& folder, std::ofstream& outputFile);
-void processDrivingBlock(Graph<int>& g, const vector<string>& blockLines, std::ofstream& outputFile);
-void processDrivingWalkingBlock(Graph<int>& g, const vector<string>& blockLines, std::ofstream& outputFile);
-void ModeDriving(Graph<int> &g, int source, int destination, std::ofstream& outputFile);
-void ModeDrivingRestrictions(Graph<int> &g, int source, int destination, std::ofstream& outputFile);
-void ModeDrivingandWalking(Graph<int> &g, int source, int destination, int maxWalkTime, std::ofstream& outputFile);
-void avoidNodesLine(Graph<int> &g);
-void avoidSegmentLine(Graph<int> &g);
-void printOutput();
+void solveBatch(const CSRGraph<int>& g, std::istream& input, std::ostream& output);
+int ServerMode(const string &address);
+void stopServer(int);
+struct BatchQuery;
+void processModeBlock(const vector<string>& blockLines, const CSRGraph<int>& g, std::ostream& outputFile);
+bool parseModeBlock(const CSRGraph<int>& g, const vector<string>& blockLines, BatchQuery& query);
+bool parseDrivingBlock(const CSRGraph<int>& g, const vector<string>& blockLines, BatchQuery& query);
+bool parseDrivingWalkingBlock(const CSRGraph<int>& g, const vector<string>& blockLines, BatchQuery& query);
+bool sharesSourceTree(const BatchQuery& query);
+void solveQuery(const CSRGraph<int>& g, const BatchQuery& query, SourceTree<int> *tree, unsigned threads, std::ostream& outputFile);
+void processTableBlock(const CSRGraph<int>& g, const vector<string>& blockLines, unsigned threads, std::ostream& outputFile);
+void ModeDriving(const CSRGraph<int> &g, int source, int destination, unsigned alternatives, std::ostream& outputFile, SourceTree<int> *tree = nullptr);
+void ModeDrivingRestrictions(const CSRGraph<int> &g, const RouteOverlay &overlay, int source, int destination, std::ostream& outputFile, SourceTree<int> *tree = nullptr);
+void ModeDrivingandWalking(const CSRGraph<int> &g, const RouteOverlay &overlay, int source, int destination, int maxWalkTime, std::ostream& outputFile, SourceTree<int> *tree = nullptr);
+void ModeTable(const CSRGraph<int> &g, const RouteOverlay &overlay, const std::vector<int> &sources, const std::vector<int> &targets, bool walking, unsigned threads, std::ostream& outputFile);
+bool parseNumber(const string &text, int &value);
+void parseNodeList(std::istream &iss, std::vector<int> &nodes);
+void parseAvoidNodes(const CSRGraph<int> &g, RouteOverlay &overlay, std::istream &iss);
+void parseAvoidSegments(const CSRGraph<int> &g, RouteOverlay &overlay, std::istream &iss);
+void parseIncludeNode(const CSRGraph<int> &g, RouteOverlay &overlay, std::istream &iss);
+void avoidNodesLine(const CSRGraph<int> &g, RouteOverlay &overlay);
+void avoidSegmentLine(const CSRGraph<int> &g, RouteOverlay &overlay);
+void includeNode(const CSRGraph<int> &g, RouteOverlay &overlay);
+void prepareEngine(const CSRGraph<int> &g, const string &folder);
+void printAlternatives(const std::vector<Route<int>> &routes, std::ostream& outputFile);
+template <class Solve>
+void cachedQuery(const QueryKey &key, std::ostream& outputFile, Solve solve);
+void printCacheStats();
 
 
-/**
- * @brief Global flag to enable Restrictions scenarios
- */
-bool enableRestrictions = false;
-
 /**
  * @brief Structure to store approximate solutions when no perfect route is found
  */
@@ -46,18 +75,169 @@ typedef struct {
     int walkingtime = INT_MAX;
     int totaltime = INT_MAX;
 } ApproximateSolution;
-ApproximateSolution approximatesolution1, approximatesolution2;
 
+/**
+ * @brief A block of batch mode, or a query of the command line, once parsed
+ * @details Driving and driving-walking queries are fully described by their key and
+ * overlay. Table blocks keep their lines, key.mode is then "table".
+ */
+struct BatchQuery {
+    QueryKey key;
+    RouteOverlay overlay;       ///< restrictions, key.restrictions is its signature
+    std::vector<string> lines;  ///< the block, for table blocks only
+};
+
+/**
+ * @brief Maximum number of blocks of batch mode read, grouped and solved together
+ */
+const size_t batchWindow = 4096;
+
+/**
+ * @brief Folder of Locations.csv and Distances.csv, set with --graph=<folder>
+ */
+string graphFolder = "../../DA2425_PRJ1_G75/src/Main/CreateGraph";
+
+/**
+ * @brief Blocks read by batch mode, set with --input=<file>, "-" for the standard input
+ */
+string batchInput = "../../DA2425_PRJ1_G75/src/Main/BatchMode/input.txt";
+
+/**
+ * @brief Answers written by batch mode, set with --output=<file>, "-" for the standard output
+ */
+string batchOutput = "../../DA2425_PRJ1_G75/src/Main/BatchMode/output.txt";
 
+/**
+ * @brief Stream of the informational messages (engine preprocessing, cache counters)
+ * @details The standard error when the answers go to the standard output.
+ */
+std::ostream *infoStream = &std::cout;
+
+/**
+ * @brief Server run by ServerMode, stopped by SIGINT and SIGTERM
+ */
+BlockServer *activeServer = nullptr;
+
+/**
+ * @brief Algorithm used for the routes of the driving modes, set with --engine=<name>
+ */
+RoutingEngine<int> engine;
+
+/**
+ * @brief Number of threads solving the blocks of batch mode, set with --threads=<n>
+ */
+unsigned batchThreads = std::max(1u, std::thread::hardware_concurrency());
+
+/**
+ * @brief Alternative routes of the driving mode, set with --alternatives=<k>
+ * @details 0 keeps the single alternative that shares no vertex with the best route.
+ * Batch blocks can override it with an "Alternatives:<k>" line.
+ */
+unsigned alternativeRoutes = 0;
+
+/**
+ * @brief Largest number of alternative routes a query can ask for
+ * @details Each one costs a spur search per vertex of the previous route, so this
+ * bounds the time a single block can hold a batch or server worker.
+ */
+const unsigned maxAlternatives = 32;
+
+/**
+ * @brief Answers of the driving and driving-walking queries already solved
+ * @details 64 MiB by default, set in MiB with --cache=<n> (0 disables it).
+ */
+QueryCache queryCache(64u << 20);
+
+
+#ifndef DA2425_NO_MAIN // the benchmarks link this file to time the modes
 /**
  * @brief Main program entry point
+ * @param argc Number of arguments
+ * @param argv Arguments: --engine=dijkstra|bidirectional|alt|ch|allpairs selects the routing algorithm,
+ * --landmarks=<k> the number of landmarks of alt, --allpairs=auto|floyd|dijkstra how allpairs fills its tables, --queue=binary|4ary|radix|dial the priority
+ * queue of dijkstra, --threads=<n> the workers of batch mode, --alternatives=<k> the number of
+ * alternative driving routes, --cache=<MiB> the memory of the query cache, --graph=<folder> the
+ * folder of the CSV files, --input=<file> and --output=<file> the files of batch mode ("-" for
+ * the standard input and output), --serve=unix:<path>|tcp:<port> a resident server (see ServerMode)
  * @return Exit status (0 for success)
  *
- * @details Initializes the graph and handles the main command loop.
- * The program loads graph data from files and presents a command-line interface
- * for route planning operations.
+ * @details Loads the graph and handles the main command loop. With --input or --output,
+ * runs batch mode once without prompting, e.g. as a filter: `--input=- --output=-`.
+ * The graph is read through its binary snapshot (see createGraphs::snapshotFromFolder)
+ * and is never modified: the restrictions of each query are kept in a RouteOverlay.
  */
-int main() {
+int main(int argc, char *argv[]) {
+    std::ios::sync_with_stdio(false);
+    bool filter = false;
+    string serve;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--engine=", 0) == 0) {
+            if (!parseEngine(arg.substr(9), engine.type)) {
+                cerr << "Error: Unknown engine " << arg.substr(9) << endl;
+                return 1;
+            }
+        } else if (arg.rfind("--landmarks=", 0) == 0) {
+            int count;
+            if (!parseNumber(arg.substr(12), count) || count < 1) {
+                cerr << "Error: --landmarks must be a positive number" << endl;
+                return 1;
+            }
+            engine.landmarkCount = count;
+        } else if (arg.rfind("--allpairs=", 0) == 0) {
+            if (!parseAllPairsMethod(arg.substr(11), engine.allPairsMethod)) {
+                cerr << "Error: Unknown all-pairs method " << arg.substr(11) << endl;
+                return 1;
+            }
+        } else if (arg.rfind("--queue=", 0) == 0) {
+            if (!parseQueuePolicy(arg.substr(8), engine.queue)) {
+                cerr << "Error: Unknown queue " << arg.substr(8) << endl;
+                return 1;
+            }
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            int threads;
+            if (!parseNumber(arg.substr(10), threads) || threads < 1) {
+                cerr << "Error: --threads must be a positive number" << endl;
+                return 1;
+            }
+            batchThreads = threads;
+        } else if (arg.rfind("--alternatives=", 0) == 0) {
+            int count;
+            if (!parseNumber(arg.substr(15), count) || count < 0 || count > (int) maxAlternatives) {
+                cerr << "Error: --alternatives must be between 0 and " << maxAlternatives << endl;
+                return 1;
+            }
+            alternativeRoutes = count;
+        } else if (arg.rfind("--cache=", 0) == 0) {
+            int mebibytes;
+            if (!parseNumber(arg.substr(8), mebibytes) || mebibytes < 0) {
+                cerr << "Error: --cache must be a number of MiB, 0 or more" << endl;
+                return 1;
+            }
+            queryCache.setBudget((size_t) mebibytes << 20);
+        } else if (arg.rfind("--serve=", 0) == 0) {
+            serve = arg.substr(8);
+        } else if (arg.rfind("--graph=", 0) == 0) {
+            graphFolder = arg.substr(8);
+        } else if (arg.rfind("--input=", 0) == 0) {
+            batchInput = arg.substr(8);
+            filter = true;
+        } else if (arg.rfind("--output=", 0) == 0) {
+            batchOutput = arg.substr(9);
+            filter = true;
+        } else {
+            cerr << "Error: Unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (batchOutput == "-") infoStream = &std::cerr;
+    if (!serve.empty()) {
+        return ServerMode(serve);
+    }
+    if (filter) {
+        BatchModeLine();
+        return 0;
+    }
 
     bool CML = true;
     while (CML) {
@@ -65,8 +245,8 @@ int main() {
         std::cout<< "If you want to Use Command Line press 'Y', if you want to Use Batch Mode Press 'T'" <<endl;
         std::cin >> input;
         if (input == "Y" or input == "y") {
-            string folder = "../../DA2425_PRJ1_G75/src/Main/CreateGraph";
-            Graph<int> g = createGraphs::graphFromFile(folder);
+            CSRGraph<int> g = createGraphs::snapshotFromFolder(graphFolder);
+            prepareEngine(g, graphFolder);
             CommandLine(g);
         } else if (input == "T" or input == "t") {
             BatchModeLine();
@@ -74,15 +254,15 @@ int main() {
         else {
             CML = false;
         }
-        enableRestrictions = false;
     }
 
     return 0;
 }
+#endif
 
 /**
  * @brief Handles the command-line interface for route planning
- * @param g Reference to the graph object
+ * @param g The graph
  *
  * @details Provides interactive menu for:
  * - Mode selection (driving/driving-walking)
@@ -90,7 +270,7 @@ int main() {
  * - Route restrictions
  * - Pre-configured test scenarios
  */
-void CommandLine(Graph<int> &g) {
+void CommandLine(const CSRGraph<int> &g) {
     bool restrictions = false;
     std::cout << "Choose one of the Modes (Driving, Driving-walking)" << std::endl;
     std::string mode;
@@ -108,96 +288,289 @@ void CommandLine(Graph<int> &g) {
     std::cout << "Source: "; std::cin >> source;
     std::cout << "Destination: "; std::cin >> destination;
 
-    std::ofstream outputFile("../../DA2425_PRJ1_G75/src/Main/BatchMode/output.txt");
+    std::ofstream outputFile(batchOutput);
     if (!outputFile) {  // Check if the file opened successfully
         std::cerr << "Error: Could not open the file!" << std::endl;
         return;
     }
 
+    BatchQuery query;
+    query.key.source = source;
+    query.key.destination = destination;
     if (mode == "Driving" || mode == "driving") {
         if (restrictions) {
-            enableRestrictions = true;
-            ModeDrivingRestrictions(g, source, destination, outputFile);
+            std::cin.ignore();
+            std::cout<<"AvoidNodes: "; avoidNodesLine(g, query.overlay);
+            std::cout<<"AvoidSegments: "; avoidSegmentLine(g, query.overlay);
+            std::cout<<"IncludeNode: "; includeNode(g, query.overlay);
+            query.key.mode = "driving-restricted";
         } else {
-            ModeDriving(g, source, destination, outputFile);
+            query.key.mode = "driving";
+            query.key.alternatives = alternativeRoutes;
         }
     } else if (mode == "Driving-walking" || mode == "driving-walking") {
         int maxWalkTime;
-        enableRestrictions = true;
         std::cout << "MaxWalkTime: "; std::cin >> maxWalkTime;
-        ModeDrivingandWalking(g, source, destination, maxWalkTime, outputFile);
+        std::cin.ignore();
+        std::cout<<"AvoidNodes: "; avoidNodesLine(g, query.overlay);
+        std::cout<<"AvoidSegments: "; avoidSegmentLine(g, query.overlay);
+        query.key.mode = "driving-walking";
+        query.key.maxWalkTime = maxWalkTime;
     }
-    printOutput();
-
+    query.key.restrictions = query.overlay.signature();
+    std::ostringstream answer;
+    if (!query.key.mode.empty()) {
+        solveQuery(g, query, nullptr, batchThreads, answer);
+    }
+    outputFile << answer.str();
+    std::cout << answer.str() << std::flush;
 }
 
 /**
- * @brief Prints the output from output.txt.
+ * @brief Runs the preprocessing of the selected engine on a freshly loaded graph
+ * @param g The graph
+ * @param folder Data folder of the graph, where the all-pairs tables are kept
+ *
+ * @details The query cache is emptied, since its answers may come from the graph
+ * loaded before (the CSV files can change between two rounds of the menu).
+ * For ALT, reports the landmarks picked, the preprocessing time and the
+ * memory taken by each landmark. For CH, the preprocessing time and the shortcuts
+ * added to each hierarchy. For all-pairs, the method used and whether the tables
+ * were computed or read back from the folder.
  */
-void printOutput() {
-    string filename = "../../DA2425_PRJ1_G75/src/Main/BatchMode/output.txt";
-    std::ifstream file;
-    file.open(filename);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open file " << filename << endl;
-        return ;
-    }
-    string line;
-    while (std::getline(file, line)) {
-        std::cout << line << std::endl;
+void prepareEngine(const CSRGraph<int> &g, const string &folder) {
+    queryCache.clear();
+    auto start = std::chrono::steady_clock::now();
+    engine.prepare(g, folder);
+    auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (engine.type == Engine::ALT) {
+        const std::vector<int> &landmarks = engine.landmarks.getLandmarks();
+        *infoStream << "ALT: " << landmarks.size() << " landmarks (";
+        for (size_t i = 0; i < landmarks.size(); i++) {
+            *infoStream << (i ? "," : "") << g.getInfo(landmarks[i]);
+        }
+        *infoStream << ") in " << ms << " ms, " << engine.landmarks.bytesPerLandmark() << " bytes per landmark" << std::endl;
+    } else if (engine.type == Engine::CH) {
+        *infoStream << "CH: " << engine.hierarchy[0].getNumShortcuts() << " driving and "
+                  << engine.hierarchy[1].getNumShortcuts() << " walking shortcuts in " << ms << " ms" << std::endl;
+    } else if (engine.type == Engine::AllPairs) {
+        const char *method = engine.allPairs.getMethod() == AllPairsMethod::FloydWarshall ? "floyd" : "dijkstra";
+        *infoStream << "AllPairs: " << (engine.allPairsLoaded ? "loaded" : "computed") << " (" << method << ") in "
+                  << ms << " ms" << std::endl;
     }
 }
 
 /**
  * @brief Handles batch Mode interface for route planning.
  *
- * @details This function processes input commands in batch mode:
- * - Reads the `input.txt` file.
- * - Processes the data in blocks based on the specified mode.
- * - Writes the results to an output file.
+ * @details Loads the graph once; every block only adds its own restrictions on top of it.
+ * Then answers the blocks of batchInput (by default `input.txt`) into batchOutput
+ * (by default `output.txt`), see solveBatch.
  */
 void BatchModeLine() {
-    string folder = "../../DA2425_PRJ1_G75/src/Main/CreateGraph";
-    string filename = "../../DA2425_PRJ1_G75/src/Main/BatchMode/input.txt";
-
-    std::ofstream outputFile("../../DA2425_PRJ1_G75/src/Main/BatchMode/output.txt");
-    if (!outputFile) {  // Check if the file opened successfully
-        std::cerr << "Error: Could not open the file!" << std::endl;
-        return;
+    std::ofstream outputFile;
+    std::ostream *output = &std::cout;
+    if (batchOutput != "-") {
+        outputFile.open(batchOutput, std::ios::binary);
+        if (!outputFile) {  // Check if the file opened successfully
+            std::cerr << "Error: Could not open the file!" << std::endl;
+            return;
+        }
+        output = &outputFile;
     }
 
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open file " << filename << endl;
-        return;
+    ifstream file;
+    std::istream *input = &std::cin;
+    if (batchInput != "-") {
+        file.open(batchInput);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open file " << batchInput << endl;
+            return;
+        }
+        input = &file;
     }
 
-    vector<string> currentBlock;
-    string line;
-    while (getline(file, line)) {
-        if (line.find("Mode:") == 0) {
-            if (!currentBlock.empty()) {
-                processModeBlock(currentBlock, folder, outputFile);
-                currentBlock.clear();
+    CSRGraph<int> g = createGraphs::snapshotFromFolder(graphFolder);
+    prepareEngine(g, graphFolder);
+
+    solveBatch(g, *input, *output);
+    file.close();
+    outputFile.close();
+    printCacheStats();
+}
+
+/**
+ * @brief Answers every block of a stream, in the order of the blocks
+ * @param g The graph, shared by all the blocks.
+ * @param input Stream of blocks, read until its end
+ * @param output Stream the answers are written to
+ *
+ * @details Runs as an OrderedPipeline, so the input can be a pipe of any size:
+ * - the reader parses the blocks, batchWindow at a time, and groups them by
+ *   (restrictions, source);
+ * - batchThreads solvers answer the groups; the queries of a group that can share a
+ *   SourceTree are answered from one driving search from the source;
+ * - the writer puts the answers back in the order of the blocks and writes them in
+ *   large chunks.
+ */
+void solveBatch(const CSRGraph<int>& g, std::istream& input, std::ostream& output) {
+    using Group = vector<std::pair<size_t, BatchQuery>>; // (position in the output, query)
+
+    string pending; // "Mode:" line that ended the previous block
+    auto nextBlock = [&](vector<string>& currentBlock) {
+        currentBlock.clear();
+        if (!pending.empty()) {
+            currentBlock.push_back(pending);
+            pending.clear();
+        }
+        string line;
+        while (getline(input, line)) {
+            if (line.find("Mode:") == 0 && !currentBlock.empty()) {
+                pending = line;
+                return true;
+            }
+            currentBlock.push_back(line);
+        }
+        return !currentBlock.empty();
+    };
+
+    auto read = [&](auto submit) {
+        vector<string> block;
+        Group window;
+        size_t seq = 0;
+        bool more = true;
+        while (more) {
+            window.clear();
+            while (window.size() < batchWindow && (more = nextBlock(block))) {
+                BatchQuery query;
+                if (parseModeBlock(g, block, query)) window.emplace_back(seq++, std::move(query));
+            }
+
+            // blocks with the same restrictions and source end up next to each other
+            std::stable_sort(window.begin(), window.end(), [](const auto &a, const auto &b) {
+                const QueryKey &x = a.second.key, &y = b.second.key;
+                return std::tie(x.restrictions, x.source) < std::tie(y.restrictions, y.source);
+            });
+            Group group;
+            size_t last = 0;
+            for (auto &entry : window) {
+                const QueryKey &key = entry.second.key;
+                const QueryKey *prev = group.empty() ? nullptr : &group.back().second.key;
+                bool joins = prev != nullptr && key.mode != "table" && prev->mode != "table"
+                             && key.restrictions == prev->restrictions && key.source == prev->source;
+                if (!joins && !group.empty()) {
+                    submit(std::move(group), last);
+                    group = Group();
+                    last = 0;
+                }
+                last = std::max(last, entry.first);
+                group.push_back(std::move(entry));
+            }
+            if (!group.empty()) submit(std::move(group), last);
+        }
+    };
+
+    auto solve = [&](const Group& group, auto emit) {
+        const BatchQuery &first = group[0].second;
+        SourceTree<int> tree(g, first.overlay, first.key.source);
+        for (const auto &[seq, query] : group) {
+            std::ostringstream result;
+            solveQuery(g, query, group.size() > 1 ? &tree : nullptr, 1, result); // already one of batchThreads
+            emit(seq, result.str());
+        }
+    };
+
+    OrderedPipeline<Group> pipeline(batchThreads, 2 * batchWindow);
+    pipeline.run(read, solve, output);
+}
+
+/**
+ * @brief Answers blocks sent over a local socket until SIGINT or SIGTERM
+ * @param address unix:<path> for a Unix domain socket, tcp:<port> for a port of 127.0.0.1
+ * @return Exit status (0 for success)
+ *
+ * @details The graph is loaded and the engine prepared once, then every block is
+ * answered with the text batch mode writes for it, by batchThreads workers shared by
+ * all the connections (see BlockServer). A block that can't be parsed gets an
+ * "Error:" line instead. The query cache is shared as well.
+ */
+int ServerMode(const string &address) {
+    CSRGraph<int> g = createGraphs::snapshotFromFolder(graphFolder);
+    prepareEngine(g, graphFolder);
+
+    BlockServer server(batchThreads, [&g](const vector<string>& block) {
+        try {
+            BatchQuery query;
+            if (!parseModeBlock(g, block, query)) {
+                return string("Error: Invalid block\n\n");
             }
+            std::ostringstream result;
+            solveQuery(g, query, nullptr, 1, result); // already one of batchThreads
+            return result.str();
+        } catch (const std::exception &e) { // a block must never take the server down
+            cerr << "Error: " << e.what() << endl;
+            return string("Error: Invalid block\n\n");
+        }
+    });
+    bool listening = false;
+    if (address.rfind("unix:", 0) == 0) {
+        listening = server.listenUnix(address.substr(5));
+    } else if (address.rfind("tcp:", 0) == 0) {
+        int port;
+        if (parseNumber(address.substr(4), port)) {
+            listening = server.listenTcp(port);
+        } else {
+            cerr << "Error: Invalid port " << address.substr(4) << endl;
         }
-        currentBlock.push_back(line);
+    } else {
+        cerr << "Error: Unknown server address " << address << endl;
     }
-    if (!currentBlock.empty()) {
-        processModeBlock(currentBlock, folder, outputFile);
+    if (!listening) return 1;
+
+    if (server.getPort() != -1) {
+        std::cout << "Serving on 127.0.0.1:" << server.getPort() << std::endl;
+    } else {
+        std::cout << "Serving on " << address.substr(5) << std::endl;
     }
-    file.close();
-    outputFile.close();
+    activeServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.run();
+    activeServer = nullptr;
+    printCacheStats();
+    return 0;
+}
+
+/**
+ * @brief Signal handler stopping the server of ServerMode
+ */
+void stopServer(int) {
+    if (activeServer != nullptr) activeServer->stop();
 }
 
 /**
  * @brief Processes a block of input lines corresponding to a specific mode.
  * @param blockLines Vector containing lines of mode-related commands.
- * @param folder Path to graph data folder.
+ * @param g The graph, shared by all the blocks.
  * @param outputFile Output stream to write results.
  */
-void processModeBlock(const vector<string>& blockLines, const string& folder, std::ofstream& outputFile) {
-    if (blockLines.empty()) return;
+void processModeBlock(const vector<string>& blockLines, const CSRGraph<int>& g, std::ostream& outputFile) {
+    BatchQuery query;
+    if (parseModeBlock(g, blockLines, query)) {
+        solveQuery(g, query, nullptr, 1, outputFile);
+    }
+}
+
+/**
+ * @brief Parses a block of input lines corresponding to a specific mode.
+ * @param g The graph, shared by all the blocks.
+ * @param blockLines Vector containing lines of mode-related commands.
+ * @param query Output: the parsed query
+ * @return false if the block has an unknown mode or misses parameters
+ */
+bool parseModeBlock(const CSRGraph<int>& g, const vector<string>& blockLines, BatchQuery& query) {
+    if (blockLines.empty()) return false;
 
     string modeLine = blockLines[0];
     std::istringstream iss(modeLine);
@@ -206,177 +579,304 @@ void processModeBlock(const vector<string>& blockLines, const string& folder, st
     std::getline(iss, text,':');
     getline(iss, mode);
 
-    Graph<int> g = createGraphs::graphFromFile(folder);
-
     if (mode == "driving" || mode == "Driving") {
-        processDrivingBlock(g, blockLines, outputFile);
+        return parseDrivingBlock(g, blockLines, query);
     } else if (mode == "driving-walking" || mode == "Driving-walking") {
-        processDrivingWalkingBlock(g, blockLines, outputFile);
+        return parseDrivingWalkingBlock(g, blockLines, query);
+    } else if (mode == "table" || mode == "Table") {
+        query.key.mode = "table";
+        query.lines = blockLines;
+        return true;
     }
+    return false;
 }
 
 /**
- * @brief Processes driving mode input.
+ * @brief Parses driving mode input.
  * @param g Graph object representing the map.
  * @param blockLines Vector containing driving-related commands.
- * @param outputFile Output stream to write results.
+ * @param query Output: a "driving" query, or "driving-restricted" if the block has restrictions
+ * @return false if Source or Destination is missing
  */
-void processDrivingBlock(Graph<int>& g, const vector<string>& blockLines, std::ofstream& outputFile) {
+bool parseDrivingBlock(const CSRGraph<int>& g, const vector<string>& blockLines, BatchQuery& query) {
     int source = -1, destination = -1;
     int IncludeNode = -1, AvoidNode = -1, AvoidSegment = -1;
+    unsigned alternatives = alternativeRoutes;
+    RouteOverlay &overlay = query.overlay;
 
     for (size_t i = 1; i < blockLines.size(); ++i) {
         string line = blockLines[i];
         if (line.find("Source:") == 0) {
-            source = stoi(line.substr(7));
+            if (!parseNumber(line.substr(7), source)) return false;
         } else if (line.find("Destination:") == 0) {
-            destination = stoi(line.substr(12));
+            if (!parseNumber(line.substr(12), destination)) return false;
         } else if (line.find("AvoidNodes:") == 0) {
             std::string avoidNodes;
             std::istringstream iss(line);
             getline(iss, avoidNodes, ':');
-            int Vertex;
-            while (iss >> Vertex) {
-                g.findVertex(Vertex)->setAvailable(-1);
-            }
+            parseAvoidNodes(g, overlay, iss);
             AvoidNode = 0;
         } else if (line.find("AvoidSegments:") == 0) {
             std::istringstream iss(line);
             std::string avoidSegment;
             getline(iss,avoidSegment,':');
-
-            char discard;
-
-            while (iss >> discard && discard == '(') {
-                int source, destination;
-                char comma;
-
-                if (!(iss >> source >> comma >> destination)) {
-                    break;
-                }
-
-                iss >> discard;
-                if (discard != ')') {
-                    break;
-                }
-                g.findVertex(source)->removeEdge(destination);
-                g.findVertex(destination)->removeEdge(source);
-
-                if (iss.peek() == ',') {
-                    iss.ignore();
-                }
-            }
+            parseAvoidSegments(g, overlay, iss);
             AvoidSegment = 0;
         } else if (line.find("IncludeNode:") == 0) {
             std::string includeNode;
             std::istringstream iss(line);
             getline(iss, includeNode, ':');
-            int Vertex;
-            while (iss >> Vertex) {
-                g.findVertex(Vertex)->setAvailable(1);
-                g.includenodevar = Vertex;
-            }
+            parseIncludeNode(g, overlay, iss);
             IncludeNode = 0;
+        } else if (line.find("Alternatives:") == 0) {
+            int count;
+            if (!parseNumber(line.substr(13), count)) return false;
+            if (count < 0 || count > (int) maxAlternatives) {
+                cerr << "Error: Alternatives must be between 0 and " << maxAlternatives << endl;
+                return false;
+            }
+            alternatives = count;
         }
     }
 
     if (source == -1 || destination == -1) {
         cerr << "Missing Source/Destination in Driving block." << endl;
-        return;
+        return false;
     }
 
+    QueryKey &key = query.key;
+    key.source = source;
+    key.destination = destination;
+    key.restrictions = overlay.signature();
     if (AvoidNode == 0 || AvoidSegment == 0 || IncludeNode == 0) {
-        ModeDrivingRestrictions(g, source, destination, outputFile);
+        key.mode = "driving-restricted";
     } else {
-        ModeDriving(g, source, destination, outputFile);
+        key.mode = "driving";
+        key.alternatives = alternatives;
     }
+    return true;
 }
 
 /**
- * @brief Processes driving-walking mode input.
+ * @brief Parses driving-walking mode input.
  * @param g Graph object representing the map.
  * @param blockLines Vector containing driving-walking-related commands.
- * @param outputFile Output stream to write results.
+ * @param query Output: a "driving-walking" query
+ * @return false if Source, Destination or MaxWalkTime is missing
  */
-void processDrivingWalkingBlock(Graph<int>& g, const vector<string>& blockLines, std::ofstream& outputFile) {
+bool parseDrivingWalkingBlock(const CSRGraph<int>& g, const vector<string>& blockLines, BatchQuery& query) {
     int source = -1, destination = -1, maxWalkTime = -1;
+    RouteOverlay &overlay = query.overlay;
 
     for (size_t i = 1; i < blockLines.size(); ++i) {
         string line = blockLines[i];
         if (line.find("Source:") == 0) {
-            source = stoi(line.substr(7));
+            if (!parseNumber(line.substr(7), source)) return false;
         } else if (line.find("Destination:") == 0) {
-            destination = stoi(line.substr(12));
+            if (!parseNumber(line.substr(12), destination)) return false;
         } else if (line.find("MaxWalkTime:") == 0) {
-            maxWalkTime = stoi(line.substr(12));
+            if (!parseNumber(line.substr(12), maxWalkTime)) return false;
         } else if (line.find("AvoidNodes:") == 0) {
             std::string avoidNodes;
             std::istringstream iss(line);
             getline(iss, avoidNodes, ':');
-            int Vertex;
-            while (iss >> Vertex) {
-                g.findVertex(Vertex)->setAvailable(-1);
-            }
+            parseAvoidNodes(g, overlay, iss);
         } else if (line.find("AvoidSegments:") == 0) {
             std::istringstream iss(line);
             std::string avoidSegment;
             getline(iss,avoidSegment,':');
+            parseAvoidSegments(g, overlay, iss);
+        }
+    }
+
+    if (source == -1 || destination == -1 || maxWalkTime == -1) {
+        cerr << "Missing parameters in Driving-Walking block." << endl;
+        return false;
+    }
 
-            char discard;
+    QueryKey &key = query.key;
+    key.mode = "driving-walking";
+    key.source = source;
+    key.destination = destination;
+    key.maxWalkTime = maxWalkTime;
+    key.restrictions = overlay.signature();
+    return true;
+}
 
-            while (iss >> discard && discard == '(') {
-                int source, destination;
-                char comma;
+/**
+ * @brief Checks if a query can be answered from a SourceTree of its source and restrictions
+ * @param query A parsed query
+ *
+ * @details Driving-walking always can: its driving search from the source is a plain
+ * dijkstra. Driving routes can when the engine is dijkstra with the binary queue, which
+ * settles vertices in the same order as the tree, and the route has no required vertices.
+ */
+bool sharesSourceTree(const BatchQuery& query) {
+    if (query.key.mode == "driving-walking") return true;
+    if (query.key.mode != "driving" && query.key.mode != "driving-restricted") return false;
+    return engine.type == Engine::Dijkstra && engine.queue == QueuePolicy::Binary && query.overlay.includeNodes.empty();
+}
 
-                if (!(iss >> source >> comma >> destination)) {
-                    break;
-                }
+/**
+ * @brief Writes the answer of a parsed query
+ * @param g The graph, shared by all the queries.
+ * @param query The query
+ * @param tree Driving labels from the source under the same restrictions, shared with
+ * other queries, or nullptr. Only used if sharesSourceTree(query).
+ * @param threads Maximum number of threads for a table, 1 when called from a worker pool
+ * @param outputFile Output stream to write results.
+ */
+void solveQuery(const CSRGraph<int>& g, const BatchQuery& query, SourceTree<int> *tree, unsigned threads, std::ostream& outputFile) {
+    const QueryKey &key = query.key;
+    if (!sharesSourceTree(query)) tree = nullptr;
+    if (key.mode == "table") {
+        processTableBlock(g, query.lines, threads, outputFile);
+    } else if (key.mode == "driving-restricted") {
+        cachedQuery(key, outputFile, [&](std::ostream& out) {
+            ModeDrivingRestrictions(g, query.overlay, key.source, key.destination, out, tree);
+        });
+    } else if (key.mode == "driving") {
+        cachedQuery(key, outputFile, [&](std::ostream& out) {
+            ModeDriving(g, key.source, key.destination, key.alternatives, out, tree);
+        });
+    } else if (key.mode == "driving-walking") {
+        cachedQuery(key, outputFile, [&](std::ostream& out) {
+            ModeDrivingandWalking(g, query.overlay, key.source, key.destination, key.maxWalkTime, out, tree);
+        });
+    }
+}
 
-                iss >> discard;
-                if (discard != ')') {
-                    break;
-                }
-                g.findVertex(source)->removeEdge(destination);
-                g.findVertex(destination)->removeEdge(source);
+/**
+ * @brief Writes the answer of a query, from the cache when it was already solved
+ * @param key Normalized query
+ * @param outputFile Output stream to write results.
+ * @param solve void(std::ostream&): writes the answer of the query
+ */
+template <class Solve>
+void cachedQuery(const QueryKey &key, std::ostream& outputFile, Solve solve) {
+    std::string answer;
+    if (!queryCache.get(key, answer)) {
+        std::ostringstream result;
+        solve(result);
+        answer = result.str();
+        queryCache.put(key, answer);
+    }
+    outputFile << answer;
+}
 
-                if (iss.peek() == ',') {
-                    iss.ignore();
-                }
-            }
+/**
+ * @brief Prints the counters of the query cache
+ */
+void printCacheStats() {
+    QueryCache::Stats stats = queryCache.getStats();
+    *infoStream << "Cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions
+              << " evictions, " << stats.entries << " entries, " << stats.bytes << " bytes" << std::endl;
+}
+
+/**
+ * @brief Processes table mode input.
+ * @param g Graph object representing the map.
+ * @param blockLines Vector containing the Sources, Targets, Metric and restriction lines.
+ * @param threads Maximum number of threads
+ * @param outputFile Output stream to write results.
+ *
+ * @details Example block:
+ * Mode:table
+ * Metric:driving
+ * Sources:1,2,3
+ * Targets:4,5
+ * AvoidNodes:
+ * AvoidSegments:
+ */
+void processTableBlock(const CSRGraph<int>& g, const vector<string>& blockLines, unsigned threads, std::ostream& outputFile) {
+    std::vector<int> sources, targets;
+    bool walking = false;
+    RouteOverlay overlay;
+
+    for (size_t i = 1; i < blockLines.size(); ++i) {
+        string line = blockLines[i];
+        if (line.find("Sources:") == 0) {
+            std::istringstream iss(line.substr(8));
+            parseNodeList(iss, sources);
+        } else if (line.find("Targets:") == 0) {
+            std::istringstream iss(line.substr(8));
+            parseNodeList(iss, targets);
+        } else if (line.find("Metric:") == 0) {
+            std::istringstream iss(line.substr(7));
+            string metric;
+            iss >> metric;
+            walking = metric == "walking" || metric == "Walking";
+        } else if (line.find("AvoidNodes:") == 0) {
+            std::istringstream iss(line.substr(11));
+            parseAvoidNodes(g, overlay, iss);
+        } else if (line.find("AvoidSegments:") == 0) {
+            std::istringstream iss(line.substr(14));
+            parseAvoidSegments(g, overlay, iss);
         }
     }
 
-    if (source == -1 || destination == -1 || maxWalkTime == -1) {
-        cerr << "Missing parameters in Driving-Walking block." << endl;
+    if (sources.empty() || targets.empty()) {
+        cerr << "Missing Sources/Targets in Table block." << endl;
         return;
     }
 
-    ModeDrivingandWalking(g, source, destination, maxWalkTime, outputFile);
+    ModeTable(g, overlay, sources, targets, walking, threads, outputFile);
 }
 
 /**
- * @brief Processes nodes to avoid from user input
- * @param g Reference to the graph object
+ * @brief Reads the number of a block line, e.g. the " 3" of "Source: 3"
+ * @param text Text after the colon; spaces around the number are allowed
+ * @param value Output: the number
+ * @return false if the text is not a number, which is printed
  */
-void avoidNodesLine(Graph<int> &g) {
-    std::string avoidNodes;
-    std::getline(std::cin, avoidNodes);
-    std::istringstream iss(avoidNodes);
+bool parseNumber(const string &text, int &value) {
+    size_t begin = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t\r") + 1;
+    if (begin != string::npos) {
+        auto [ptr, ec] = std::from_chars(text.data() + begin, text.data() + end, value);
+        if (ec == std::errc() && ptr == text.data() + end) return true;
+    }
+    cerr << "Error: Invalid number \"" << text << "\"" << endl;
+    return false;
+}
+
+/**
+ * @brief Reads a list of node IDs, e.g. "1,2,3" or "1 2 3"
+ * @param iss Stream positioned at the first ID
+ * @param nodes Output: the IDs are appended, in order
+ */
+void parseNodeList(std::istream &iss, std::vector<int> &nodes) {
     int Vertex;
     while (iss >> Vertex) {
-        g.findVertex(Vertex)->setAvailable(-1);
+        nodes.push_back(Vertex);
+        if (iss.peek() == ',') {
+            iss.ignore();
+        }
     }
+}
 
+/**
+ * @brief Reads a list of nodes to avoid, e.g. "2 7"
+ * @param g The graph
+ * @param overlay Restrictions of the query being read
+ * @param iss Stream positioned after "AvoidNodes:"
+ */
+void parseAvoidNodes(const CSRGraph<int> &g, RouteOverlay &overlay, std::istream &iss) {
+    int Vertex;
+    while (iss >> Vertex) {
+        if (!overlay.avoidNode(g, Vertex)) {
+            cerr << "Error: Unknown node " << Vertex << endl;
+        }
+    }
 }
 
 /**
- * @brief Processes segments to avoid from user input
- * @param g Reference to the graph object
+ * @brief Reads a list of segments to avoid, e.g. "(3,2),(7,8)"
+ * @param g The graph
+ * @param overlay Restrictions of the query being read
+ * @param iss Stream positioned after "AvoidSegments:"
  */
-void avoidSegmentLine(Graph<int> &g) {
-    std::string avoidSegment;
-    std::getline(std::cin, avoidSegment);
-    std::istringstream iss(avoidSegment);
+void parseAvoidSegments(const CSRGraph<int> &g, RouteOverlay &overlay, std::istream &iss) {
     char discard;
 
     while (iss >> discard && discard == '(') {
@@ -391,53 +891,131 @@ void avoidSegmentLine(Graph<int> &g) {
         if (discard != ')') {
             break;
         }
-        g.findVertex(source)->removeEdge(destination);
-        g.findVertex(destination)->removeEdge(source);
+        if (!overlay.avoidSegment(g, source, destination)) {
+            cerr << "Error: Unknown segment (" << source << "," << destination << ")" << endl;
+        }
 
         if (iss.peek() == ',') {
             iss.ignore();
         }
     }
+}
 
+/**
+ * @brief Reads the nodes the route must include, e.g. "7" or "7,12,20"
+ * @param g The graph
+ * @param overlay Restrictions of the query being read
+ * @param iss Stream positioned after "IncludeNode:"
+ */
+void parseIncludeNode(const CSRGraph<int> &g, RouteOverlay &overlay, std::istream &iss) {
+    int Vertex;
+    while (iss >> Vertex) {
+        if (!overlay.addIncludeNode(g, Vertex)) {
+            cerr << "Error: Unknown node " << Vertex << endl;
+        }
+        if (iss.peek() == ',') {
+            iss.ignore();
+        }
+    }
+}
+
+/**
+ * @brief Processes nodes to avoid from user input
+ * @param g The graph
+ * @param overlay Restrictions of the query being read
+ */
+void avoidNodesLine(const CSRGraph<int> &g, RouteOverlay &overlay) {
+    std::string avoidNodes;
+    std::getline(std::cin, avoidNodes);
+    std::istringstream iss(avoidNodes);
+    parseAvoidNodes(g, overlay, iss);
+}
+
+/**
+ * @brief Processes segments to avoid from user input
+ * @param g The graph
+ * @param overlay Restrictions of the query being read
+ */
+void avoidSegmentLine(const CSRGraph<int> &g, RouteOverlay &overlay) {
+    std::string avoidSegment;
+    std::getline(std::cin, avoidSegment);
+    std::istringstream iss(avoidSegment);
+    parseAvoidSegments(g, overlay, iss);
 }
 
 /**
  * @brief Processes nodes to include in route from user input
- * @param g Reference to the graph object
+ * @param g The graph
+ * @param overlay Restrictions of the query being read
  */
-void includeNode(Graph<int> &g) {
+void includeNode(const CSRGraph<int> &g, RouteOverlay &overlay) {
     std::string IncludeNode;
     std::getline(std::cin, IncludeNode);
     std::istringstream iss(IncludeNode);
-    int Vertex;
-    while (iss >> Vertex) {
-        g.findVertex(Vertex)->setAvailable(1);
-        g.includenodevar = Vertex;
+    parseIncludeNode(g, overlay, iss);
+}
+
+/**
+ * @brief Writes the next alternatives of the driving mode, "AlternativeDrivingRoute<i>: ..."
+ * @param routes Routes found by kShortestRoutes, the best one first
+ * @param outputFile Output stream
+ */
+void printAlternatives(const std::vector<Route<int>> &routes, std::ostream& outputFile) {
+    if (routes.size() <= 1) {
+        outputFile<<'\n'<<"AlternativeDrivingRoute1: None";
+    }
+    for (size_t r = 1; r < routes.size(); r++) {
+        outputFile<<'\n'<<"AlternativeDrivingRoute"<<r<<": ";
+        const std::vector<int> &route = routes[r].vertices;
+        for (size_t i = 0; i < route.size(); ++i) {
+            if (i != route.size() - 1) {
+                outputFile << route[i] << ",";
+            } else {
+                outputFile << route[i] << "(" << routes[r].cost <<")";
+            }
+        }
     }
 }
 
 /**
  * @brief Finds the fastest driving route between two nodes
- * @param g Reference to the graph object
+ * @param g The graph
  * @param source Starting node ID
  * @param destination Target node ID
+ * @param alternatives Number of alternative routes, 0 for the independent one, at most maxAlternatives
+ * @param tree Driving labels from the source without restrictions, or nullptr to search them
  *
- * @details Calculates both the optimal route and an alternative independent route.
+ * @details Calculates both the optimal route and alternative routes:
+ * - with alternatives = 0, one independent route, which avoids every intermediate
+ *   node of the optimal one through a temporary overlay;
+ * - otherwise the next best loopless routes (kShortestRoutes), which may share
+ *   parts of the optimal one.
  * Outputs the routes with their respective travel times.
  */
-void ModeDriving(Graph<int> &g, int source, int destination, std::ofstream& outputFile) {
-    dijkstra(&g, source);
-    std::vector<int> bestDrivingRoute = getPath(&g, source, destination);
-    int cost1 = getCost(&g, destination);
-    for (int i = 1; i < bestDrivingRoute.size()-1; i++) {
-        g.findVertex(bestDrivingRoute[i])->setAvailable(-1);
+void ModeDriving(const CSRGraph<int> &g, int source, int destination, unsigned alternatives, std::ostream& outputFile, SourceTree<int> *tree) {
+    std::vector<int> bestDrivingRoute, AlternativeDrivingRoute;
+    int cost1;
+    if (tree != nullptr) {
+        bestDrivingRoute = getPath(g, tree->get(), source, destination);
+        cost1 = getCost(g, tree->get(), destination);
+    } else {
+        cost1 = shortestRoute(g, RouteOverlay(), source, destination, false, bestDrivingRoute, engine);
+    }
+    int cost2 = INF_DIST;
+    std::vector<Route<int>> routes;
+    if (alternatives > 0) {
+        routes = kShortestRoutes(g, RouteOverlay(), bestDrivingRoute, alternatives + 1, false,
+                                 threadContext(0), threadContext(1));
+    } else {
+        RouteOverlay alternative;
+        for (size_t i = 1; i + 1 < bestDrivingRoute.size(); i++) {
+            alternative.avoidNode(g, bestDrivingRoute[i]);
+        }
+        cost2 = shortestRoute(g, alternative, source, destination, false, AlternativeDrivingRoute, engine);
     }
-    dijkstra(&g, source);
-    std::vector<int> AlternativeDrivingRoute = getPath(&g, source, destination);
-    int cost2 = getCost(&g, destination);
 
-    outputFile<<"Source: "<<source<<endl;
-    outputFile<<"Destination: "<<destination<<endl;
+    outputFile<<"Source: "<<source<<'\n';
+    outputFile<<"Destination: "<<destination<<'\n';
     outputFile<<"BestDrivingRoute: ";
     if (bestDrivingRoute.empty()) {
         outputFile << "None";
@@ -450,7 +1028,12 @@ void ModeDriving(Graph<int> &g, int source, int destination, std::ofstream& outp
             }
         }
     }
-    outputFile<<endl<<"AlternativeDrivingRoute: ";
+    if (alternatives > 0) {
+        printAlternatives(routes, outputFile);
+        outputFile<<'\n'<<'\n';
+        return;
+    }
+    outputFile<<'\n'<<"AlternativeDrivingRoute: ";
     if (AlternativeDrivingRoute.empty()) {
         outputFile << "None";
     } else {
@@ -462,47 +1045,37 @@ void ModeDriving(Graph<int> &g, int source, int destination, std::ofstream& outp
             }
         }
     }
-    outputFile<<endl<<endl;
+    outputFile<<'\n'<<'\n';
 }
 
 /**
  * @brief Finds driving route with restrictions
- * @param g Reference to the graph object
+ * @param g The graph
+ * @param overlay Restrictions of the query
  * @param source Starting node ID
  * @param destination Target node ID
+ * @param tree Driving labels from the source under the same restrictions, or nullptr to search them
  *
  * @details Handles:
  * - Avoided nodes
  * - Avoided segments
  * - Required nodes to include
  */
-void ModeDrivingRestrictions(Graph<int> &g, int source, int destination, std::ofstream& outputFile) {
-    if (enableRestrictions) {
-        std::cin.ignore();
-        std::cout<<"AvoidNodes: "; avoidNodesLine(g);
-        std::cout<<"AvoidSegments: "; avoidSegmentLine(g);
-        std::cout<<"IncludeNode: "; includeNode(g);
-    }
-
+void ModeDrivingRestrictions(const CSRGraph<int> &g, const RouteOverlay &overlay, int source, int destination, std::ostream& outputFile, SourceTree<int> *tree) {
     std::vector<int> RestrictedDrivingRoute;
     int cost1;
 
-    if (g.includenodevar != -1) {
-        dijkstra(&g, g.includenodevar);
-        std::vector<int> aux = getPath(&g, g.includenodevar, destination);
-        cost1 =getCost(&g, destination);
-        dijkstra(&g, source);
-        RestrictedDrivingRoute = getPath(&g, source, g.includenodevar);
-        cost1 += getCost(&g, g.includenodevar);
-        RestrictedDrivingRoute.insert(RestrictedDrivingRoute.end(), aux.begin()+1, aux.end());
+    if (!overlay.includeNodes.empty()) {
+        cost1 = waypointRoute(g, overlay, source, destination, threadContext(0), RestrictedDrivingRoute);
+    } else if (tree != nullptr) {
+        RestrictedDrivingRoute = getPath(g, tree->get(), source, destination);
+        cost1 = getCost(g, tree->get(), destination);
     } else {
-        dijkstra(&g, source);
-        RestrictedDrivingRoute = getPath(&g, source, destination);
-        cost1 =getCost(&g, destination);
+        cost1 = shortestRoute(g, overlay, source, destination, false, RestrictedDrivingRoute, engine);
     }
 
-    outputFile<<"Source: " <<source<<endl;
-    outputFile<<"Destination: " <<destination<<endl;
+    outputFile<<"Source: " <<source<<'\n';
+    outputFile<<"Destination: " <<destination<<'\n';
     outputFile<<"RestrictedDrivingRoute: ";
     if (RestrictedDrivingRoute.empty()) {
         outputFile << "None";
@@ -515,15 +1088,17 @@ void ModeDrivingRestrictions(Graph<int> &g, int source, int destination, std::of
             }
         }
     }
-    outputFile<<endl<<endl;
+    outputFile<<'\n'<<'\n';
 }
 
 /**
  * @brief Finds optimal combined driving-walking route
- * @param g Reference to the graph object
+ * @param g The graph
+ * @param overlay Restrictions of the query
  * @param source Starting node ID
  * @param destination Target node ID
  * @param maxWalkTime Maximum allowed walking time in minutes
+ * @param tree Driving labels from the source under the same restrictions, or nullptr to search them
  *
  * @details Finds route that:
  * 1. Starts with driving
@@ -532,65 +1107,64 @@ void ModeDrivingRestrictions(Graph<int> &g, int source, int destination, std::of
  * 4. Respects max walking time
  *
  * If no perfect route is found, provides up to two approximate solutions.
+ * The times of every parking node come from two searches, a driving one from the
+ * source and a walking one backwards from the destination.
  */
 
-void ModeDrivingandWalking(Graph<int> &g, int source, int destination, int maxWalkTime, std::ofstream& outputFile) {
-    if (enableRestrictions) {
-        std::cin.ignore();
-        std::cout<<"AvoidNodes: "; avoidNodesLine(g);
-        std::cout<<"AvoidSegments: "; avoidSegmentLine(g);
-    }
+void ModeDrivingandWalking(const CSRGraph<int> &g, const RouteOverlay &overlay, int source, int destination, int maxWalkTime, std::ostream& outputFile, SourceTree<int> *tree) {
+    int s = g.findIdx(source);
+    int d = g.findIdx(destination);
 
     //ensuring source and destination are not parking nodes
-    if (g.findVertex(source)->getParking() || g.findVertex(destination)->getParking()) {
-        outputFile << "Source or destination cannot be parking nodes." << std::endl;
+    if ((s != -1 && g.getParking(s)) || (d != -1 && g.getParking(d))) {
+        outputFile << "Source or destination cannot be parking nodes." << '\n';
         return;
     }
 
-    //ensuring source and destination are not adjacent
-    for (auto edge : g.findVertex(source)->getAdj()) {
-        if (edge->getDest()->getInfo() == destination) {
-            outputFile <<  "Source and destination cannot be adjacent nodes." << std::endl;
-            return;
+    //ensuring source and destination are not adjacent (an avoided segment no longer connects them)
+    if (s != -1) {
+        for (int e = g.outBegin(s); e < g.outEnd(s); e++) {
+            if (!overlay.isEdgeAvoided(e) && g.getDest(e) == d) {
+                outputFile <<  "Source and destination cannot be adjacent nodes." << '\n';
+                return;
+            }
         }
     }
 
     //finding all parking nodes
     std::vector<int> parkingNodes;
-    for (auto vertex : g.getVertexSet()) {
-        if (vertex->getParking()) {
-            parkingNodes.push_back(vertex->getInfo());
+    for (int v = 0; v < g.getNumVertex(); v++) {
+        if (g.getParking(v)) {
+            parkingNodes.push_back(g.getInfo(v));
         }
     }
 
     // to store the best route
     std::vector<int> bestDrivingRoute, bestWalkingRoute;
     int bestParkingNode = -1;
-    int bestTotalTime = INF;
+    int bestTotalTime = INT_MAX;
     int bestWalkingTime = 0;
     int bestDrivingTime = 0;
+    ApproximateSolution approximatesolution1, approximatesolution2;
 
-    //iterating over all the parking nodes
+    //driving time from the source to every node, walking time from every node to the destination
+    SearchContext &walk = threadContext(1);
+    if (tree == nullptr) dijkstra(g, overlay, source, false, threadContext(0), parkingNodes);
+    const SearchContext &drive = tree != nullptr ? tree->get() : threadContext(0);
+    dijkstraReverse(g, overlay, destination, true, walk, parkingNodes);
+
+    //iterating over all the parking nodes, routes are only built for the chosen ones
     for (int parkingNode : parkingNodes) {
-        //compute driving route from source to parking node
-        dijkstra(&g, source);
-        std::vector<int> drivingRoute = getPath(&g, source, parkingNode);
-        int drivingTime = getCost(&g, parkingNode);
-
-        //compute walking route from parking node to destination
-        g.switchwalking = true;
-        dijkstra(&g, parkingNode);
-        g.switchwalking = false;
-        std::vector<int> walkingRoute = getPath(&g, parkingNode, destination);
-        int walkingTime = getCost(&g, destination);
+        int p = g.findIdx(parkingNode);
+        if (p == -1 || drive.getDist(p) == INF_DIST || walk.getDist(p) == INF_DIST) continue; //can't park there
+        int drivingTime = drive.getDist(p);
+        int walkingTime = walk.getDist(p);
         //checking if walking time is within the limit
         int totalTime = drivingTime + walkingTime;
 
         if (walkingTime <= maxWalkTime) {
             //update best route if this one is better
             if (totalTime < bestTotalTime || (totalTime == bestTotalTime && walkingTime > bestWalkingTime)) {
-                bestDrivingRoute = drivingRoute;
-                bestWalkingRoute = walkingRoute;
                 bestParkingNode = parkingNode;
                 bestTotalTime = totalTime;
                 bestDrivingTime = drivingTime;
@@ -599,51 +1173,60 @@ void ModeDrivingandWalking(Graph<int> &g, int source, int destination, int maxWa
         } else {
             if (walkingTime < approximatesolution1.walkingtime) {
                 if (approximatesolution2.totaltime == INT_MAX || approximatesolution1.totaltime < approximatesolution2.totaltime) {
-                    approximatesolution2.DrivingRoute = approximatesolution1.DrivingRoute;
                     approximatesolution2.ParkingNode = approximatesolution1.ParkingNode;
-                    approximatesolution2.WalkingRoute = approximatesolution1.WalkingRoute;
                     approximatesolution2.walkingtime = approximatesolution1.walkingtime;
                     approximatesolution2.drivingtime = approximatesolution1.drivingtime;
                 }
-                approximatesolution1.DrivingRoute = drivingRoute;
                 approximatesolution1.ParkingNode = parkingNode;
-                approximatesolution1.WalkingRoute = walkingRoute;
                 approximatesolution1.walkingtime = walkingTime;
                 approximatesolution1.drivingtime = drivingTime;
             } else if (walkingTime < approximatesolution2.walkingtime) {
-                approximatesolution2.DrivingRoute = drivingRoute;
                 approximatesolution2.ParkingNode = parkingNode;
-                approximatesolution2.WalkingRoute = walkingRoute;
                 approximatesolution2.walkingtime = walkingTime;
                 approximatesolution2.drivingtime = drivingTime;
             }
         }
     }
 
+    //the walking routes are searched forwards, to pick the same route as before among equal cost ones
+    SearchContext &walkForward = threadContext(2);
+    if (bestParkingNode != -1) {
+        bestDrivingRoute = getPath(g, drive, source, bestParkingNode);
+        dijkstra(g, overlay, bestParkingNode, destination, true, walkForward);
+        bestWalkingRoute = getPath(g, walkForward, bestParkingNode, destination);
+    } else {
+        for (ApproximateSolution *solution : {&approximatesolution1, &approximatesolution2}) {
+            if (solution->ParkingNode == -1) continue;
+            solution->DrivingRoute = getPath(g, drive, source, solution->ParkingNode);
+            dijkstra(g, overlay, solution->ParkingNode, destination, true, walkForward);
+            solution->WalkingRoute = getPath(g, walkForward, solution->ParkingNode, destination);
+        }
+    }
+
     //output the best route
-    outputFile << "Source: " << source << std::endl;
-    outputFile << "Destination: " << destination << std::endl;
+    outputFile << "Source: " << source << '\n';
+    outputFile << "Destination: " << destination << '\n';
     if (bestParkingNode == -1) {
-        outputFile << "Message: No possible route with max. walking time of " << maxWalkTime << " minutes." << std::endl;
+        outputFile << "Message: No possible route with max. walking time of " << maxWalkTime << " minutes." << '\n';
         if (approximatesolution1.walkingtime != -1) {
                 outputFile << "DrivingRoute1: ";
                 for (size_t i = 0; i < approximatesolution1.DrivingRoute.size(); ++i) {
                     if (i != approximatesolution1.DrivingRoute.size() - 1) {
                         outputFile << approximatesolution1.DrivingRoute[i] << ",";
                     } else {
-                        outputFile << approximatesolution1.DrivingRoute[i] << "(" << approximatesolution1.drivingtime << ")" << std::endl;
+                        outputFile << approximatesolution1.DrivingRoute[i] << "(" << approximatesolution1.drivingtime << ")" << '\n';
                     }
                 }
-                outputFile << "ParkingNode1: " << approximatesolution1.ParkingNode << std::endl;
+                outputFile << "ParkingNode1: " << approximatesolution1.ParkingNode << '\n';
                 outputFile << "WalkingRoute1: ";
                 for (size_t i = 0; i < approximatesolution1.WalkingRoute.size(); ++i) {
                     if (i != approximatesolution1.WalkingRoute.size() - 1) {
                         outputFile << approximatesolution1.WalkingRoute[i] << ",";
                     } else {
-                        outputFile << approximatesolution1.WalkingRoute[i] << "(" << approximatesolution1.walkingtime << ")" << std::endl;
+                        outputFile << approximatesolution1.WalkingRoute[i] << "(" << approximatesolution1.walkingtime << ")" << '\n';
                     }
                 }
-                outputFile << "TotalTime1: " << (approximatesolution1.walkingtime + approximatesolution1.drivingtime) << std::endl;
+                outputFile << "TotalTime1: " << (approximatesolution1.walkingtime + approximatesolution1.drivingtime) << '\n';
 
                 if (approximatesolution2.walkingtime != -1) {
                     outputFile << "DrivingRoute2: ";
@@ -651,24 +1234,24 @@ void ModeDrivingandWalking(Graph<int> &g, int source, int destination, int maxWa
                         if (i != approximatesolution2.DrivingRoute.size() - 1) {
                             outputFile << approximatesolution2.DrivingRoute[i] << ",";
                         } else {
-                            outputFile << approximatesolution2.DrivingRoute[i] << "(" << approximatesolution2.drivingtime << ")" << std::endl;
+                            outputFile << approximatesolution2.DrivingRoute[i] << "(" << approximatesolution2.drivingtime << ")" << '\n';
                         }
                     }
-                    outputFile << "ParkingNode2: " << approximatesolution2.ParkingNode << std::endl;
+                    outputFile << "ParkingNode2: " << approximatesolution2.ParkingNode << '\n';
                     outputFile << "WalkingRoute2: ";
                     for (size_t i = 0; i < approximatesolution2.WalkingRoute.size(); ++i) {
                         if (i != approximatesolution2.WalkingRoute.size() - 1) {
                             outputFile << approximatesolution2.WalkingRoute[i] << ",";
                         } else {
-                            outputFile << approximatesolution2.WalkingRoute[i] << "(" << approximatesolution2.walkingtime << ")" << std::endl;
+                            outputFile << approximatesolution2.WalkingRoute[i] << "(" << approximatesolution2.walkingtime << ")" << '\n';
                         }
                     }
-                    outputFile << "TotalTime2: " << (approximatesolution2.walkingtime + approximatesolution2.drivingtime) << std::endl;
+                    outputFile << "TotalTime2: " << (approximatesolution2.walkingtime + approximatesolution2.drivingtime) << '\n';
                 }
             } else {
-                outputFile << "DrivingRoute:none" << std::endl;
-                outputFile << "ParkingNode:none" << std::endl;
-                outputFile << "WalkingRoute:none" << std::endl;
+                outputFile << "DrivingRoute:none" << '\n';
+                outputFile << "ParkingNode:none" << '\n';
+                outputFile << "WalkingRoute:none" << '\n';
             }
     } else {
         outputFile << "DrivingRoute: ";
@@ -676,19 +1259,61 @@ void ModeDrivingandWalking(Graph<int> &g, int source, int destination, int maxWa
             if ( i != bestDrivingRoute.size() - 1) {
             outputFile << bestDrivingRoute[i] << ",";
             } else {
-            outputFile << bestDrivingRoute[i] << "(" << bestDrivingTime << ")" << std::endl;
+            outputFile << bestDrivingRoute[i] << "(" << bestDrivingTime << ")" << '\n';
             }
         }
-        outputFile << "ParkingNode: " << bestParkingNode << std::endl;
+        outputFile << "ParkingNode: " << bestParkingNode << '\n';
         outputFile << "WalkingRoute: ";
         for (size_t i = 0; i < bestWalkingRoute.size(); ++i) {
             if (i != bestWalkingRoute.size() - 1) {
             outputFile << bestWalkingRoute[i] << ",";
             } else {
-                outputFile << bestWalkingRoute[i] << "(" << bestWalkingTime << ")" << std::endl;
+                outputFile << bestWalkingRoute[i] << "(" << bestWalkingTime << ")" << '\n';
+            }
+        }
+        outputFile << "TotalTime: " << bestTotalTime << '\n';
+    }
+    outputFile<<'\n';
+}
+
+/**
+ * @brief Writes the table of times from every source to every target
+ * @param g The graph
+ * @param overlay Restrictions of the query
+ * @param sources IDs of the sources, one row each
+ * @param targets IDs of the targets, one column each
+ * @param walking false for driving times, true for walking times
+ * @param threads Maximum number of threads the rows are spread over; 1 when the
+ * caller is already a batch or server worker, so tables don't multiply the threads
+ * @param outputFile Output stream to write results.
+ *
+ * @details Unreachable pairs are written as None.
+ */
+void ModeTable(const CSRGraph<int> &g, const RouteOverlay &overlay, const std::vector<int> &sources, const std::vector<int> &targets, bool walking, unsigned threads, std::ostream& outputFile) {
+    for (int id : sources) {
+        if (g.findIdx(id) == -1) cerr << "Error: Unknown node " << id << endl;
+    }
+    for (int id : targets) {
+        if (g.findIdx(id) == -1) cerr << "Error: Unknown node " << id << endl;
+    }
+    DistanceTable<int> table = distanceTable(g, overlay, sources, targets, walking, engine, threads);
+
+    outputFile << "Sources: ";
+    for (size_t i = 0; i < sources.size(); ++i) outputFile << (i ? "," : "") << sources[i];
+    outputFile << '\n' << "Targets: ";
+    for (size_t j = 0; j < targets.size(); ++j) outputFile << (j ? "," : "") << targets[j];
+    outputFile << '\n' << (walking ? "WalkingTable:" : "DrivingTable:") << '\n';
+    for (size_t i = 0; i < sources.size(); ++i) {
+        outputFile << sources[i] << ": ";
+        for (size_t j = 0; j < targets.size(); ++j) {
+            if (j) outputFile << ",";
+            if (table.at(i, j) == INF_DIST) {
+                outputFile << "None";
+            } else {
+                outputFile << table.at(i, j);
             }
         }
-        outputFile << "TotalTime: " << bestTotalTime << std::endl;
+        outputFile << '\n';
     }
-    outputFile<<endl;
-}
\ No newline at end of file
+    outputFile << '\n';
+}